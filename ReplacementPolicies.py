@@ -27,6 +27,7 @@
 from m5.params import *
 from m5.proxy import *
 from m5.SimObject import SimObject
+from m5.util.pybind import PyBindMethod
 
 
 class BaseReplacementPolicy(SimObject):
@@ -176,16 +177,150 @@ class WeightedLRURP(LRURP):
     cxx_class = "gem5::replacement_policy::WeightedLRU"
     cxx_header = "mem/cache/replacement_policies/weighted_lru_rp.hh"
 
+class SLRUPTEPolicy(ScopedEnum):
+    vals = ["Normal", "InsertProtected", "PromoteOnHit"]
+
+
 class SLRURP(BaseReplacementPolicy):
     type       = "SLRURP"
     cxx_class  = "gem5::replacement_policy::SLRU"
     cxx_header = "mem/cache/replacement_policies/slru_rp.hh"
 
+    cxx_exports = [
+        PyBindMethod("pinRange"),
+        PyBindMethod("demoteRange"),
+        PyBindMethod("clearRangeHints"),
+        PyBindMethod("tracePhase"),
+    ]
+
     protected_size = Param.Unsigned(
         Parent.assoc,
-        "Number of lines to keep in the protected segment"
+        "Number of lines per set to keep in the protected segment "
+        "(capped at assoc - 1)"
     )
     probation_size = Param.Unsigned(
         Parent.assoc,
         "Number of lines to keep in the probationary segment"
-    )
\ No newline at end of file
+    )
+    assoc = Param.Unsigned(
+        Parent.assoc,
+        "Associativity of the cache, used to group entries into sets"
+    )
+    correlated_period = Param.Unsigned(
+        0,
+        "Accesses to the set after a line's last uncorrelated reference "
+        "during which re-touches refresh recency but are not promoted "
+        "(0 disables the filter)"
+    )
+    pin_budget = Param.Unsigned(
+        1,
+        "Maximum pinned lines per set (capped at protected_size)"
+    )
+    pinned_ranges = VectorParam.AddrRange(
+        [],
+        "Address ranges whose lines are pinned in the protected segment"
+    )
+    demoted_ranges = VectorParam.AddrRange(
+        [],
+        "Address ranges whose lines are inserted at probation LRU and "
+        "never promoted"
+    )
+    row_aware_window = Param.Unsigned(
+        1,
+        "Number of oldest probationary lines among which the victim whose "
+        "DRAM row is open is preferred (1 = plain LRU, at most 16)"
+    )
+    migration_budget = Param.Unsigned(
+        0,
+        "Promoted lines this bank may migrate or replicate toward the "
+        "requestor's nearest bank per migration_epoch (0 disables NUCA "
+        "migration)"
+    )
+    migration_epoch = Param.Latency(
+        "10us", "Length of the epoch over which migration_budget applies"
+    )
+    sharing_aware = Param.Bool(
+        False,
+        "Promote lines used by several requestors on their first re-touch "
+        "(needs correlated_period) and demote them after private lines"
+    )
+    criticality_table_size = Param.Unsigned(
+        0,
+        "Entries of the per-PC load criticality table fed by the O3 CPU, a "
+        "power of two (0 disables criticality-aware promotion)"
+    )
+    criticality_threshold = Param.Unsigned(
+        4,
+        "Score (1-7) from which a PC's fills are inserted into the "
+        "protected segment"
+    )
+    pte_policy = Param.SLRUPTEPolicy(
+        "Normal",
+        "Treatment of lines filled by the page table walker: Normal, "
+        "InsertProtected or PromoteOnHit"
+    )
+    pc_table_size = Param.Unsigned(
+        0,
+        "Entries of the per-PC miss/hit/promotion/eviction attribution "
+        "table, a power of two (0 disables it)"
+    )
+    pc_report_top = Param.Unsigned(
+        32,
+        "Number of PCs, by misses, written to <name>.pc_report.txt at each "
+        "stats dump"
+    )
+    trace_file = Param.String(
+        "",
+        "Chrome trace (JSON, viewable in Perfetto) of fills, evictions, "
+        "writebacks, promotions and demotions, relative to the output "
+        "directory (empty disables tracing)"
+    )
+    trace_set_sampling = Param.Unsigned(
+        64,
+        "Trace the events of one set in every N"
+    )
+    snapshot_file = Param.String(
+        "",
+        "Binary file, relative to the output directory, receiving periodic "
+        "snapshots of the resident lines with their segment, recency rank "
+        "and written state (empty disables snapshots)"
+    )
+    snapshot_interval = Param.Latency(
+        "1ms",
+        "Time between two resident-line snapshots"
+    )
+    dataset_file = Param.String(
+        "",
+        "Binary file, relative to the output directory, receiving a feature "
+        "record for each hit and eviction in sampled sets (empty disables "
+        "the dataset)"
+    )
+    dataset_set_sampling = Param.Unsigned(
+        32,
+        "Record the hits and evictions of one set in every N"
+    )
+    writer_buffer_size = Param.MemorySize(
+        "64KiB",
+        "Bytes of trace events, snapshots or dataset records buffered "
+        "before they are handed to the stream's writer thread"
+    )
+    writer_max_pending = Param.Unsigned(
+        64,
+        "Buffers waiting for a stream's writer thread before further trace "
+        "events, snapshots or dataset records are dropped"
+    )
+    predictor_file = Param.String(
+        "",
+        "Decision table over the hashed PC and request type, used for "
+        "insertion and promotion decisions (empty disables the predictor)"
+    )
+    num_cores = Param.Unsigned(
+        0,
+        "Cores, by context ID, of the cross-core interference matrix "
+        "(0 disables it)"
+    )
+    ghost_entries = Param.Unsigned(
+        1024,
+        "Entries of the direct-mapped ghost tag buffer that catches victims "
+        "re-referenced soon after their eviction, a power of two"
+    )
@@ -0,0 +1,150 @@
+#include "mem/cache/replacement_policies/slru_async_writer.hh"
+
+#include <pthread.h>
+
+#include <mutex>
+#include <set>
+#include <utility>
+
+namespace gem5 {
+namespace replacement_policy {
+
+namespace
+{
+
+std::mutex registryMutex;
+std::once_flag atforkOnce;
+
+std::set<SLRUAsyncWriter*> &
+registry()
+{
+    static std::set<SLRUAsyncWriter*> writers;
+    return writers;
+}
+
+} // anonymous namespace
+
+SLRUAsyncWriter::SLRUAsyncWriter(std::ostream &os, size_t buffer_bytes,
+                                 size_t max_pending)
+  : os(os),
+    bufferBytes(buffer_bytes),
+    maxPending(max_pending),
+    dropped(0),
+    closing(false),
+    thread(&SLRUAsyncWriter::run, this)
+{
+    current.reserve(bufferBytes);
+
+    std::call_once(atforkOnce, []()
+        {
+            pthread_atfork(&SLRUAsyncWriter::lockAll,
+                           &SLRUAsyncWriter::unlockAll,
+                           &SLRUAsyncWriter::unlockAll);
+        });
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry().insert(this);
+}
+
+SLRUAsyncWriter::~SLRUAsyncWriter()
+{
+    close();
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry().erase(this);
+}
+
+void
+SLRUAsyncWriter::lockAll()
+{
+    registryMutex.lock();
+    for (auto *writer : registry()) {
+        writer->mutex.lock();
+    }
+}
+
+void
+SLRUAsyncWriter::unlockAll()
+{
+    for (auto *writer : registry()) {
+        writer->mutex.unlock();
+    }
+    registryMutex.unlock();
+}
+
+void
+SLRUAsyncWriter::write(const char *data, size_t len)
+{
+    current.append(data, len);
+    if (current.size() >= bufferBytes) {
+        flush();
+    }
+}
+
+void
+SLRUAsyncWriter::flush()
+{
+    if (current.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.size() < maxPending) {
+            pending.push_back(std::move(current));
+        } else {
+            // Never block the simulation on a slow disk
+            dropped += current.size();
+        }
+    }
+    cv.notify_one();
+
+    current.clear();
+    current.reserve(bufferBytes);
+}
+
+void
+SLRUAsyncWriter::close()
+{
+    if (!thread.joinable()) {
+        return;
+    }
+
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    cv.notify_one();
+    thread.join();
+    os.flush();
+}
+
+uint64_t
+SLRUAsyncWriter::droppedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return dropped;
+}
+
+void
+SLRUAsyncWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this] { return closing || !pending.empty(); });
+        if (pending.empty()) {
+            // Only reached when closing with nothing left to write
+            break;
+        }
+
+        std::string buffer = std::move(pending.front());
+        pending.pop_front();
+
+        lock.unlock();
+        os.write(buffer.data(), buffer.size());
+        lock.lock();
+    }
+}
+
+}
+}
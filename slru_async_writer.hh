@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace gem5 {
+namespace replacement_policy {
+
+/**
+ * Writes SLRU trace and dump output on a background thread so that
+ * formatting and file I/O do not stall the event loop. Data is appended to
+ * a buffer that is handed over to the writer thread once it is full. At
+ * most maxPending buffers wait for the thread; further buffers are dropped
+ * and counted rather than blocking the simulation.
+ *
+ * The simulator may be forked, e.g. to dump stats from a snapshot. Every
+ * writer's lock is held across fork() so that the child never inherits
+ * one held by a writer thread it does not have.
+ */
+class SLRUAsyncWriter
+{
+  public:
+    /**
+     * @param os Stream written by the background thread only.
+     * @param buffer_bytes Size at which a buffer is handed over.
+     * @param max_pending Buffers that may wait before new ones are dropped.
+     */
+    SLRUAsyncWriter(std::ostream &os, size_t buffer_bytes,
+                    size_t max_pending);
+    ~SLRUAsyncWriter();
+
+    void write(const char *data, size_t len);
+    void write(const std::string &data) { write(data.data(), data.size()); }
+
+    /** Hand the current buffer over, even if it is not full. */
+    void flush();
+
+    /** Flush, wait for the thread to drain all buffers and stop it. */
+    void close();
+
+    uint64_t droppedBytes() const;
+
+  private:
+    void run();
+
+    /** pthread_atfork handlers covering every live writer. */
+    static void lockAll();
+    static void unlockAll();
+
+    std::ostream &os;
+    const size_t bufferBytes;
+    const size_t maxPending;
+
+    std::string current;
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::string> pending;
+    uint64_t dropped;
+    bool closing;
+    std::thread thread;
+};
+
+}
+}
@@ -1,93 +1,1353 @@
-
 #include "mem/cache/replacement_policies/slru_rp.hh"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <limits>
 #include <memory>
+#include <ostream>
+#include <sstream>
 
+#include "base/logging.hh"
+#include "base/output.hh"
+#include "base/str.hh"
+#include "enums/SLRUPTEPolicy.hh"
+#include "mem/packet.hh"
+#include "mem/request.hh"
 #include "params/SLRURP.hh"
+#include "sim/core.hh"
 #include "sim/cur_tick.hh"
+#include "sim/sim_exit.hh"
 
 namespace gem5 {
 namespace replacement_policy {
 
+namespace
+{
+
+/** Append an unsigned LEB128 varint. */
+void
+putVarint(std::string &buf, uint64_t value)
+{
+    while (value >= 0x80) {
+        buf.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buf.push_back(static_cast<char>(value));
+}
+
+} // anonymous namespace
+
 SLRU::SLRU(const Params &p)
   : Base(p),
-    protectedSize(p.protected_size),
+    assoc(p.assoc),
+    // At least one way per set has to stay in probation so that getVictim
+    // always finds a candidate
+    protectedSize(std::min(p.protected_size, p.assoc - 1)),
     probationSize(p.probation_size),
-    protectedEntries(0)
-{}
+    correlatedPeriod(p.correlated_period),
+    pinBudget(std::min(p.pin_budget, protectedSize)),
+    rowAwareWindow(p.row_aware_window),
+    rowHint(nullptr),
+    sharingAware(p.sharing_aware),
+    ptePolicy(p.pte_policy),
+    criticalityThreshold(p.criticality_threshold),
+    criticality(p.criticality_table_size, 0),
+    loadCommitsSeen(false),
+    pcTable(p.pc_table_size),
+    pcReportTop(p.pc_report_top),
+    pcReport(nullptr),
+    traceSetSampling(p.trace_set_sampling),
+    traceStream(nullptr),
+    snapshotInterval(p.snapshot_interval),
+    snapshotStream(nullptr),
+    snapshotEvent([this]() { takeSnapshot(); }, name() + ".snapshot"),
+    datasetSetSampling(p.dataset_set_sampling),
+    datasetStream(nullptr),
+    predictorPCBits(0),
+    numCores(p.num_cores),
+    ghosts(p.num_cores > 0 ? p.ghost_entries : 0),
+    migrationBudget(p.migration_budget),
+    migrationEpoch(p.migration_epoch),
+    migrationHandler(nullptr),
+    migrationEpochIndex(0),
+    migrationsInEpoch(0),
+    numEntries(0),
+    chunkUsed(setsPerChunk),
+    stats(this, p.num_cores)
+{
+    fatal_if(assoc == 0, "SLRU needs a set-associative cache\n");
+    fatal_if(rowAwareWindow == 0 || rowAwareWindow > maxRowAwareWindow,
+             "row_aware_window must be between 1 and %u\n",
+             maxRowAwareWindow);
+    fatal_if(migrationEpoch == 0, "migration_epoch must be non-zero\n");
+    fatal_if(!criticality.empty() &&
+             (criticality.size() & (criticality.size() - 1)) != 0,
+             "criticality_table_size must be a power of two\n");
+    fatal_if(criticalityThreshold == 0 ||
+             criticalityThreshold > maxCriticality,
+             "criticality_threshold must be between 1 and %u\n",
+             maxCriticality);
+    fatal_if((pcTable.size() & (pcTable.size() - 1)) != 0,
+             "pc_table_size must be a power of two\n");
+    fatal_if(traceSetSampling == 0, "trace_set_sampling must be non-zero\n");
+    fatal_if(!p.snapshot_file.empty() && snapshotInterval == 0,
+             "snapshot_interval must be non-zero\n");
+    fatal_if(numCores >= unknownOwner,
+             "num_cores must be below %u\n", unknownOwner);
+    fatal_if((ghosts.size() & (ghosts.size() - 1)) != 0,
+             "ghost_entries must be a power of two\n");
+    fatal_if(datasetSetSampling == 0,
+             "dataset_set_sampling must be non-zero\n");
+    // Without the correlated-reference filter every probationary re-touch
+    // is promoted, so options that only bypass the filter do nothing
+    warn_if(correlatedPeriod == 0 &&
+            ptePolicy == enums::SLRUPTEPolicy::PromoteOnHit,
+            "%s: pte_policy=PromoteOnHit has no effect without "
+            "correlated_period\n", name());
+    warn_if(correlatedPeriod == 0 && sharingAware,
+            "%s: sharing_aware only changes the demotion order without "
+            "correlated_period\n", name());
+
+    for (const auto &range : p.pinned_ranges) {
+        addRangeHint(range, RangeHint::Protect);
+    }
+    for (const auto &range : p.demoted_ranges) {
+        addRangeHint(range, RangeHint::Demote);
+    }
+
+    // Opened up front: stats dumps may run in forked children, which would
+    // each truncate a report they created themselves
+    if (!pcTable.empty()) {
+        pcReport = simout.create(name() + ".pc_report.txt");
+    }
+
+    if (!p.trace_file.empty()) {
+        traceStream = simout.create(p.trace_file);
+        traceWriter = std::make_unique<SLRUAsyncWriter>(
+            *traceStream->stream(), p.writer_buffer_size,
+            p.writer_max_pending);
+        // JSON array format; the process is named after this policy
+        traceWriter->write("[\n{\"name\":\"process_name\",\"ph\":\"M\","
+            "\"pid\":1,\"args\":{\"name\":\"" + name() + "\"}}");
+        registerExitCallback([this]() { closeTrace(); });
+    }
+
+    if (!p.snapshot_file.empty()) {
+        snapshotStream = simout.create(p.snapshot_file, true);
+        snapshotWriter = std::make_unique<SLRUAsyncWriter>(
+            *snapshotStream->stream(), p.writer_buffer_size,
+            p.writer_max_pending);
+        std::string header("SLRUSNP1");
+        putVarint(header, assoc);
+        snapshotWriter->write(header);
+        registerExitCallback([this]() { closeSnapshots(); });
+    }
+
+    if (!p.dataset_file.empty()) {
+        datasetStream = simout.create(p.dataset_file, true);
+        datasetWriter = std::make_unique<SLRUAsyncWriter>(
+            *datasetStream->stream(), p.writer_buffer_size,
+            p.writer_max_pending);
+        datasetWriter->write("SLRUFEA1");
+        registerExitCallback([this]() { closeDataset(); });
+    }
+
+    if (!p.predictor_file.empty()) {
+        loadPredictor(p.predictor_file);
+    }
+}
+
+SLRU::SetState &
+SLRU::getSet(uint32_t set) const
+{
+    assert(set < setIndex.size());
+    if (setIndex[set] != nullptr) {
+        return *setIndex[set];
+    }
+
+    // First access to this set: carve its state out of the current chunk
+    if (chunkUsed == setsPerChunk) {
+        const size_t bytes = setsPerChunk * assoc;
+        const size_t lines = (bytes + sizeof(Line) - 1) / sizeof(Line);
+        SetChunk chunk;
+        chunk.sets = std::make_unique<SetState[]>(setsPerChunk);
+        chunk.stamps = std::make_unique<Line[]>(lines * sizeof(uint32_t));
+        chunk.refStamps = std::make_unique<Line[]>(lines * sizeof(uint32_t));
+        chunk.addrs = std::make_unique<Line[]>(lines * sizeof(Addr));
+        chunk.sharers = std::make_unique<Line[]>(lines * sizeof(uint64_t));
+        chunk.segments = std::make_unique<Line[]>(lines);
+        chunk.flags = std::make_unique<Line[]>(lines);
+        chunk.owners = std::make_unique<Line[]>(lines);
+        setChunks.push_back(std::move(chunk));
+        chunkUsed = 0;
+    }
+
+    SetChunk &chunk = setChunks.back();
+    SetState *state = &chunk.sets[chunkUsed];
+    state->index = set;
+    state->clock = 0;
+    state->protectedEntries = 0;
+    state->pinnedEntries = 0;
+    state->victimWay = assoc;
+    state->victimAddr = MaxAddr;
+    state->victimOwner = unknownOwner;
+    state->victimPromoted = false;
+    state->stamp = reinterpret_cast<uint32_t*>(chunk.stamps.get()) +
+        chunkUsed * assoc;
+    state->refStamp = reinterpret_cast<uint32_t*>(chunk.refStamps.get()) +
+        chunkUsed * assoc;
+    state->addr = reinterpret_cast<Addr*>(chunk.addrs.get()) +
+        chunkUsed * assoc;
+    state->sharers = reinterpret_cast<uint64_t*>(chunk.sharers.get()) +
+        chunkUsed * assoc;
+    state->segment = reinterpret_cast<uint8_t*>(chunk.segments.get()) +
+        chunkUsed * assoc;
+    state->flags = reinterpret_cast<uint8_t*>(chunk.flags.get()) +
+        chunkUsed * assoc;
+    state->owner = reinterpret_cast<uint8_t*>(chunk.owners.get()) +
+        chunkUsed * assoc;
+    std::fill(state->stamp, state->stamp + assoc, 0);
+    std::fill(state->refStamp, state->refStamp + assoc, 0);
+    std::fill(state->addr, state->addr + assoc, MaxAddr);
+    std::fill(state->sharers, state->sharers + assoc, 0);
+    std::fill(state->segment, state->segment + assoc,
+              SLRUReplData::Probation);
+    std::fill(state->flags, state->flags + assoc, 0);
+    std::fill(state->owner, state->owner + assoc, unknownOwner);
+    chunkUsed++;
+
+    setIndex[set] = state;
+    return *state;
+}
+
+void
+SLRU::updateRecency(SetState &set, uint32_t way) const
+{
+    if (set.clock == std::numeric_limits<uint32_t>::max()) {
+        // Replace the stamps by their rank before the clock wraps around
+        std::vector<uint32_t> rank(assoc, 0);
+        uint32_t filled = 0;
+        for (uint32_t i = 0; i < assoc; i++) {
+            if (set.stamp[i] == 0) {
+                continue;
+            }
+            filled++;
+            for (uint32_t j = 0; j < assoc; j++) {
+                if (set.stamp[j] != 0 && set.stamp[j] <= set.stamp[i]) {
+                    rank[i]++;
+                }
+            }
+        }
+        std::copy(rank.begin(), rank.end(), set.stamp);
+        // Old reference stamps are meaningless after the rebase
+        std::fill(set.refStamp, set.refStamp + assoc, 0);
+        set.clock = filled;
+    }
+    set.stamp[way] = ++set.clock;
+}
+
+bool
+SLRU::demoteLRU(SetState &set) const
+{
+    // Find LRU in protected segment by comparing stamps. Pinned entries
+    // are never demoted, and with sharing awareness shared entries only go
+    // once no private one is left.
+    uint32_t lru = assoc;
+    uint32_t oldest = std::numeric_limits<uint32_t>::max();
+    bool lru_shared = true;
+    for (uint32_t way = 0; way < assoc; way++) {
+        if (set.segment[way] != SLRUReplData::Protected ||
+            (set.flags[way] & Pinned)) {
+            continue;
+        }
+        const bool shared = sharingAware && isShared(set, way);
+        if (lru == assoc || shared < lru_shared ||
+            (shared == lru_shared && set.stamp[way] < oldest)) {
+            oldest = set.stamp[way];
+            lru_shared = shared;
+            lru = way;
+        }
+    }
+    if (lru == assoc) {
+        return false;
+    }
+
+    set.segment[lru] = SLRUReplData::Probation;
+    set.protectedEntries--;
+    stats.demotions++;
+    traceEvent(set, lru, "demotion");
+    return true;
+}
+
+bool
+SLRU::protect(SetState &set, uint32_t way) const
+{
+    // Make room by demoting the LRU protected entry to probation
+    if (set.protectedEntries == protectedSize && !demoteLRU(set)) {
+        return false;
+    }
+
+    set.segment[way] = SLRUReplData::Protected;
+    set.flags[way] |= Promoted;
+    set.protectedEntries++;
+    traceEvent(set, way, "promotion");
+    return true;
+}
+
+bool
+SLRU::pin(SetState &set, uint32_t way) const
+{
+    if (set.pinnedEntries >= pinBudget) {
+        stats.pinBudgetExhausted++;
+        return false;
+    }
+    if (set.segment[way] != SLRUReplData::Protected && !protect(set, way)) {
+        return false;
+    }
+
+    set.flags[way] |= Pinned;
+    set.pinnedEntries++;
+    return true;
+}
+
+void
+SLRU::releaseWay(SetState &set, uint32_t way) const
+{
+    // Release its protected and pinned slots if it had them
+    if (set.segment[way] == SLRUReplData::Protected) {
+        set.protectedEntries--;
+    }
+    if (set.flags[way] & Pinned) {
+        set.pinnedEntries--;
+    }
+    set.segment[way] = SLRUReplData::Probation;
+    set.flags[way] = 0;
+}
+
+bool
+SLRU::isShared(const SetState &set, uint32_t way) const
+{
+    // More than one requestor bit set
+    return (set.sharers[way] & (set.sharers[way] - 1)) != 0;
+}
+
+void
+SLRU::addSharer(SetState &set, uint32_t way, ContextID requestor) const
+{
+    if (requestor != InvalidContextID) {
+        set.sharers[way] |= uint64_t(1) << (requestor % 64);
+    }
+}
+
+bool
+SLRU::isCorrelated(const SetState &set, uint32_t way) const
+{
+    return correlatedPeriod > 0 && set.refStamp[way] != 0 &&
+        set.clock - set.refStamp[way] < correlatedPeriod;
+}
+
+void
+SLRU::addRangeHint(const AddrRange &range, RangeHint hint)
+{
+    assert(hint != RangeHint::None);
+    rangeHints.emplace_back(range, hint);
+}
+
+void
+SLRU::pinRange(Addr start, Addr end)
+{
+    addRangeHint(AddrRange(start, end), RangeHint::Protect);
+}
+
+void
+SLRU::demoteRange(Addr start, Addr end)
+{
+    addRangeHint(AddrRange(start, end), RangeHint::Demote);
+}
+
+void
+SLRU::clearRangeHints()
+{
+    rangeHints.clear();
+
+    // Resident lines lose their pins; they stay protected until demoted
+    for (SetState *set : setIndex) {
+        if (set == nullptr) {
+            continue;
+        }
+        for (uint32_t way = 0; way < assoc; way++) {
+            set->flags[way] &= ~(Pinned | Demoted);
+        }
+        set->pinnedEntries = 0;
+    }
+}
 
 void
 SLRU::invalidate(const std::shared_ptr<ReplacementData>& rd)
 {
-    auto data = std::static_pointer_cast<SLRUReplData>(rd);
-    // Remove from protected list if it was there
-    if (data->segment == SLRUReplData::Protected) {
-        auto it = std::find(protectedList.begin(), protectedList.end(), rd);
-        if (it != protectedList.end()) {
-            protectedList.erase(it);
-            protectedEntries--;
+    auto data = static_cast<const SLRUReplData*>(rd.get());
+    SetState *set = setIndex[data->set];
+    // Nothing to clear in a set that was never accessed
+    if (set == nullptr) {
+        return;
+    }
+
+    // Caches invalidate their victim before refilling the way, so this is
+    // the last chance to see the evicted line
+    if (set->victimWay == data->way && (set->flags[data->way] & Valid)) {
+        evictWay(*set, data->way);
+    }
+
+    releaseWay(*set, data->way);
+    set->stamp[data->way]   = 0;
+    set->refStamp[data->way] = 0;
+    set->addr[data->way] = MaxAddr;
+    set->sharers[data->way] = 0;
+}
+
+SLRU::AccessHints
+SLRU::getHints(const PacketPtr pkt) const
+{
+    AccessHints hints;
+    if (pkt && pkt->req) {
+        // Set by requests that ask for the line to be evicted next. The
+        // x86 decoder does not set it for MOVNT* or PREFETCHNTA yet.
+        hints.nonTemporal =
+            pkt->req->getFlags().isSet(Request::EVICT_NEXT);
+        hints.pageTableWalk =
+            pkt->req->getFlags().isSet(Request::PT_WALK);
+    }
+    if (pkt && pkt->req && pkt->req->hasContextId()) {
+        hints.requestor = pkt->req->contextId();
+    }
+    if (pkt && pkt->req && pkt->req->hasPC()) {
+        hints.pc = pkt->req->getPC();
+    }
+    if (pkt) {
+        hints.addr = pkt->getAddr();
+        hints.write = pkt->isWrite();
+        for (const auto &[range, hint] : rangeHints) {
+            if (range.contains(pkt->getAddr())) {
+                hints.range = hint;
+                break;
+            }
         }
     }
-    data->segment   = SLRUReplData::Probation;
-    data->lastTouch = Tick(0);
+    return hints;
 }
 
 void
-SLRU::reset(const std::shared_ptr<ReplacementData>& rd) const
+SLRU::warnPacketless() const
 {
-    auto data = std::static_pointer_cast<SLRUReplData>(rd);
-    // Remove from protected list if it was there
-    if (data->segment == SLRUReplData::Protected) {
-        auto it = std::find(protectedList.begin(), protectedList.end(), rd);
-        if (it != protectedList.end()) {
-            protectedList.erase(it);
-            protectedEntries--;
+    // Ruby's CacheMemory has no packet to pass on, so there is no
+    // requestor or PC to attribute the access to
+    warn_if_once(numCores > 0,
+                 "%s: num_cores needs packet-aware accesses; the cross-core "
+                 "interference stats stay empty\n", name());
+    warn_if_once(!pcTable.empty(),
+                 "%s: pc_table_size needs packet-aware accesses; the "
+                 "per-PC table stays empty\n", name());
+    warn_if_once(datasetWriter != nullptr,
+                 "%s: dataset_file needs packet-aware accesses; records "
+                 "carry no PC, address or core, and every eviction is "
+                 "labelled 0\n", name());
+    warn_if_once(snapshotWriter != nullptr,
+                 "%s: snapshot_file needs packet-aware fills; snapshots "
+                 "only list lines whose address is known\n", name());
+}
+
+void
+SLRU::resetEntry(const SLRUReplData &data, const AccessHints &hints) const
+{
+    SetState &set = getSet(data.set);
+    const uint32_t way = data.way;
+
+    // A victim that was not invalidated first is evicted by the refill
+    if (set.victimWay == way && (set.flags[way] & Valid)) {
+        evictWay(set, way);
+    }
+    recordFill(set, way, hints);
+
+    PCEntry *pc_entry = lookupPC(hints.pc);
+    if (pc_entry) {
+        pc_entry->misses++;
+        if (set.victimWay == way) {
+            pc_entry->evictions++;
+        }
+    }
+    noteInterference(set, set.victimWay == way, hints);
+    if (set.victimWay == way) {
+        set.victimWay = assoc;
+    }
+
+    releaseWay(set, way);
+    set.flags[way] |= Valid;
+    set.owner[way] = coreIndex(hints.requestor);
+    set.addr[way] = hints.addr;
+    set.sharers[way] = 0;
+    addSharer(set, way, hints.requestor);
+    traceEvent(set, way, "fill");
+    if (isCriticalPC(hints.pc)) {
+        set.flags[way] |= Critical;
+        stats.criticalFills++;
+    }
+    if (hints.write) {
+        set.flags[way] |= Written;
+    }
+    if (hints.pageTableWalk) {
+        set.flags[way] |= PageTable;
+        stats.pteFills++;
+    }
+
+    if (hints.range == RangeHint::Protect && pin(set, way)) {
+        stats.pinnedFills++;
+        updateRecency(set, way);
+        set.refStamp[way] = set.stamp[way];
+        return;
+    }
+
+    // A PTE line miss serializes a whole page walk
+    if (hints.pageTableWalk &&
+        ptePolicy == enums::SLRUPTEPolicy::InsertProtected &&
+        protect(set, way)) {
+        stats.promotions++;
+        updateRecency(set, way);
+        set.refStamp[way] = set.stamp[way];
+        return;
+    }
+
+    if (hints.nonTemporal || hints.range == RangeHint::Demote) {
+        // Insert at the probation LRU position, with no reference period
+        set.stamp[way] = 0;
+        set.refStamp[way] = 0;
+        if (hints.nonTemporal) {
+            set.flags[way] |= NonTemporal;
+            stats.nonTemporalFills++;
+        }
+        if (hints.range == RangeHint::Demote) {
+            set.flags[way] |= Demoted;
+            stats.demotedFills++;
+        }
+        return;
+    }
+
+    // A critical load's next miss would block commit again, so its line
+    // starts protected rather than waiting for a re-touch
+    if ((set.flags[way] & Critical) && protect(set, way)) {
+        stats.promotions++;
+        stats.criticalPromotions++;
+        updateRecency(set, way);
+        set.refStamp[way] = set.stamp[way];
+        return;
+    }
+
+    const uint8_t insert =
+        predict(insertTable, hints, stats.insertDecisions);
+    if (insert == PredictLow) {
+        set.stamp[way] = 0;
+        set.refStamp[way] = 0;
+        return;
+    }
+    if (insert == PredictHigh && protect(set, way)) {
+        updateRecency(set, way);
+        set.refStamp[way] = set.stamp[way];
+        return;
+    }
+
+    updateRecency(set, way);
+    // The fill opens the correlated-reference period
+    set.refStamp[way] = set.stamp[way];
+}
+
+void
+SLRU::touchEntry(const SLRUReplData &data, const AccessHints &hints) const
+{
+    SetState &set = getSet(data.set);
+    const uint32_t way = data.way;
+
+    recordHit(set, way, hints);
+
+    if (hints.write) {
+        set.flags[way] |= Written;
+    }
+    addSharer(set, way, hints.requestor);
+    if (set.flags[way] & PageTable) {
+        stats.pteHits++;
+    }
+    if (set.segment[way] == SLRUReplData::Protected) {
+        stats.protectedHits++;
+    } else {
+        stats.probationHits++;
+    }
+    PCEntry *pc_entry = lookupPC(hints.pc);
+    if (pc_entry) {
+        pc_entry->hits++;
+    }
+
+    // Lines already resident when their range was registered get pinned
+    // on their next access
+    if (hints.range == RangeHint::Protect && !(set.flags[way] & Pinned)) {
+        pin(set, way);
+    }
+    if (set.flags[way] & Pinned) {
+        stats.pinnedHits++;
+        updateRecency(set, way);
+        return;
+    }
+
+    if (set.segment[way] == SLRUReplData::Probation && protectedSize > 0) {
+        if (set.flags[way] & Demoted) {
+            // Software asked for this range to never be protected
+            updateRecency(set, way);
+            return;
+        }
+
+        if (hints.nonTemporal || (set.flags[way] & NonTemporal)) {
+            // Non-temporal data is not expected to be reused, so its first
+            // re-touch does not promote it either
+            set.flags[way] &= ~NonTemporal;
+            updateRecency(set, way);
+            return;
+        }
+
+        const uint8_t promote =
+            predict(promoteTable, hints, stats.promoteDecisions);
+        if (promote == PredictLow) {
+            updateRecency(set, way);
+            return;
+        }
+
+        // Lines actively used by several cores, or filled by loads that
+        // tend to block commit and since demoted, skip the correlation
+        // filter and are promoted on their first re-touch
+        if (sharingAware && isShared(set, way)) {
+            stats.sharedPromotions++;
+        } else if (set.flags[way] & Critical) {
+            stats.criticalPromotions++;
+        } else if ((set.flags[way] & PageTable) &&
+                   ptePolicy == enums::SLRUPTEPolicy::PromoteOnHit) {
+            // Promoted on its first hit regardless of correlation
+        } else if (promote == PredictHigh) {
+            // The predictor expects reuse, correlated or not
+        } else if (isCorrelated(set, way)) {
+            // Same burst of references as the last one: refresh recency
+            // without counting it as reuse
+            stats.filteredPromotions++;
+            updateRecency(set, way);
+            return;
+        }
+
+        if (protect(set, way)) {
+            stats.promotions++;
+            if (pc_entry) {
+                pc_entry->promotions++;
+            }
+            requestMigration(set, way, hints);
         }
     }
-    data->segment   = SLRUReplData::Probation;
-    data->lastTouch = curTick();
+    updateRecency(set, way);
+    set.refStamp[way] = set.stamp[way];
+}
+
+void
+SLRU::reset(const std::shared_ptr<ReplacementData>& rd) const
+{
+    warnPacketless();
+    resetEntry(*static_cast<const SLRUReplData*>(rd.get()), AccessHints());
+}
+
+void
+SLRU::reset(const std::shared_ptr<ReplacementData>& rd, const PacketPtr pkt)
+{
+    resetEntry(*static_cast<const SLRUReplData*>(rd.get()), getHints(pkt));
 }
 
 void
 SLRU::touch(const std::shared_ptr<ReplacementData>& rd) const
 {
-    auto data = std::static_pointer_cast<SLRUReplData>(rd);
-    Tick now = curTick();
+    warnPacketless();
+    touchEntry(*static_cast<const SLRUReplData*>(rd.get()), AccessHints());
+}
 
-    if (data->segment == SLRUReplData::Probation) {
-        if (protectedEntries < protectedSize) {
-            data->segment = SLRUReplData::Protected;
-            protectedList.push_back(rd);
-            protectedEntries++;
+void
+SLRU::touch(const std::shared_ptr<ReplacementData>& rd, const PacketPtr pkt)
+{
+    touchEntry(*static_cast<const SLRUReplData*>(rd.get()), getHints(pkt));
+}
+
+void
+SLRU::setMigrationHandler(MigrationHandler *handler)
+{
+    migrationHandler = handler;
+}
+
+void
+SLRU::requestMigration(const SetState &set, uint32_t way,
+                       const AccessHints &hints) const
+{
+    if (migrationHandler == nullptr || migrationBudget == 0 ||
+        hints.requestor == InvalidContextID || set.addr[way] == MaxAddr) {
+        return;
+    }
+
+    // The budget is per bank, as each L2 bank has its own policy
+    const Tick epoch = curTick() / migrationEpoch;
+    if (epoch != migrationEpochIndex) {
+        migrationEpochIndex = epoch;
+        migrationsInEpoch = 0;
+    }
+    if (migrationsInEpoch == migrationBudget) {
+        stats.migrationsThrottled++;
+        return;
+    }
+
+    const bool read_only = !(set.flags[way] & Written);
+    const unsigned saved_hops =
+        migrationHandler->migrate(set.addr[way], hints.requestor, read_only);
+    if (saved_hops == 0) {
+        return;
+    }
+
+    migrationsInEpoch++;
+    if (read_only) {
+        stats.replications++;
+    } else {
+        stats.migrations++;
+    }
+    stats.savedHops += saved_hops;
+}
+
+void
+SLRU::recordLoadCommit(Addr pc, bool stalled_head)
+{
+    if (criticality.empty()) {
+        return;
+    }
+
+    loadCommitsSeen = true;
+    uint8_t &score = criticality[criticalityIndex(pc)];
+    if (stalled_head) {
+        if (score < maxCriticality) {
+            score++;
+        }
+    } else if (score > 0) {
+        score--;
+    }
+}
+
+size_t
+SLRU::criticalityIndex(Addr pc) const
+{
+    // Drop the low bits, which carry little entropy for load PCs
+    return ((pc >> 2) ^ (pc >> 13)) & (criticality.size() - 1);
+}
+
+bool
+SLRU::isCriticalPC(Addr pc) const
+{
+    return !criticality.empty() && pc != MaxAddr &&
+        criticality[criticalityIndex(pc)] >= criticalityThreshold;
+}
+
+void
+SLRU::noteVictim(SetState &set, uint32_t way) const
+{
+    // CHI controllers, among others, search again when the victim they
+    // got is busy; the last pick is the one that gets replaced
+    if (set.victimWay != assoc) {
+        stats.victimRetries++;
+    }
+    // Remember a valid victim so that its eviction is only recorded once
+    // it happens, and the fill replacing it can be charged with it
+    set.victimWay = (set.flags[way] & Valid) ? way : assoc;
+}
+
+void
+SLRU::evictWay(SetState &set, uint32_t way) const
+{
+    if (isShared(set, way)) {
+        stats.sharedEvictions++;
+    }
+    traceEvent(set, way, "eviction");
+    if (set.flags[way] & Written) {
+        traceEvent(set, way, "writeback");
+    }
+    recordEviction(set, way);
+
+    set.victimAddr = set.addr[way];
+    set.victimOwner = set.owner[way];
+    set.victimPromoted = set.flags[way] & Promoted;
+}
+
+uint8_t
+SLRU::coreIndex(ContextID requestor) const
+{
+    return requestor >= 0 && unsigned(requestor) < numCores ?
+        uint8_t(requestor) : unknownOwner;
+}
+
+SLRU::GhostEntry &
+SLRU::ghostEntry(Addr addr) const
+{
+    // Line address, assuming lines of at least 64 bytes
+    const Addr line = addr >> 6;
+    return ghosts[(line ^ (line >> 16)) & (ghosts.size() - 1)];
+}
+
+void
+SLRU::noteInterference(SetState &set, bool evicted,
+                       const AccessHints &hints) const
+{
+    if (numCores == 0) {
+        return;
+    }
+
+    // Refetching a ghost means its eviction was premature
+    if (!ghosts.empty() && hints.addr != MaxAddr) {
+        GhostEntry &ghost = ghostEntry(hints.addr);
+        if (ghost.addr == hints.addr) {
+            stats.ghostHits[ghost.evictor][ghost.victim]++;
+            ghost = GhostEntry();
+        }
+    }
+
+    if (!evicted || set.victimAddr == MaxAddr) {
+        return;
+    }
+
+    const uint8_t evictor = coreIndex(hints.requestor);
+    if (evictor != unknownOwner && set.victimOwner != unknownOwner) {
+        stats.crossEvictions[evictor][
+            set.victimOwner * 2 + set.victimPromoted]++;
+        if (!ghosts.empty()) {
+            ghostEntry(set.victimAddr) =
+                {set.victimAddr, evictor, set.victimOwner};
+        }
+    }
+    set.victimAddr = MaxAddr;
+}
+
+void
+SLRU::traceEvent(const SetState &set, uint32_t way, const char *event) const
+{
+    if (!traceWriter || set.index % traceSetSampling != 0) {
+        return;
+    }
+
+    // One thread per set, so that each set gets its own timeline track
+    char buf[256];
+    const int len = std::snprintf(buf, sizeof(buf),
+        ",\n{\"name\":\"%s\",\"cat\":\"slru\",\"ph\":\"i\",\"s\":\"t\","
+        "\"ts\":%.6f,\"pid\":1,\"tid\":%u,\"args\":{\"way\":%u,"
+        "\"addr\":\"0x%llx\",\"segment\":\"%s\"}}",
+        event, curTick() / sim_clock::as_float::us, set.index, way,
+        static_cast<unsigned long long>(set.addr[way]),
+        set.segment[way] == SLRUReplData::Protected ?
+            "protected" : "probation");
+    traceWriter->write(buf, std::min<size_t>(len, sizeof(buf) - 1));
+    stats.traceEvents++;
+}
+
+void
+SLRU::tracePhase(const std::string &phase) const
+{
+    if (!traceWriter) {
+        return;
+    }
+
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.6f",
+                  curTick() / sim_clock::as_float::us);
+    traceWriter->write(",\n{\"name\":\"" + phase + "\",\"cat\":\"phase\","
+        "\"ph\":\"i\",\"s\":\"g\",\"ts\":" + buf + ",\"pid\":1,\"tid\":0}");
+}
+
+void
+SLRU::closeTrace()
+{
+    if (!traceWriter) {
+        return;
+    }
+
+    traceWriter->write("\n]\n");
+    traceWriter->close();
+    warn_if(traceWriter->droppedBytes() > 0,
+            "%s: dropped %llu bytes of trace, the writer fell behind\n",
+            name(), traceWriter->droppedBytes());
+    traceWriter.reset();
+    simout.close(traceStream);
+    traceStream = nullptr;
+}
+
+void
+SLRU::startup()
+{
+    Base::startup();
+
+    // Controllers attach their hooks before the simulation starts, so a
+    // missing one here means the option has nothing to act on
+    warn_if(migrationBudget > 0 && !migrationHandler,
+            "%s: migration_budget is set but no migration handler is "
+            "attached; promotions will not migrate lines\n", name());
+    warn_if(rowAwareWindow > 1 && !rowHint,
+            "%s: row_aware_window is set but no row buffer hint is "
+            "attached; victims are picked in plain LRU order\n", name());
+
+    if (snapshotWriter) {
+        schedule(snapshotEvent, curTick() + snapshotInterval);
+    }
+}
+
+void
+SLRU::takeSnapshot()
+{
+    struct Resident
+    {
+        Addr addr;
+        uint32_t set;
+        uint32_t way;
+        uint32_t rank;
+        uint8_t info;
+    };
+
+    std::vector<Resident> lines;
+    for (const SetState *set : setIndex) {
+        if (set == nullptr) {
+            continue;
+        }
+        for (uint32_t way = 0; way < assoc; way++) {
+            if (set->addr[way] == MaxAddr) {
+                continue;
+            }
+            // Rank 0 is the most recently used way of the set
+            uint32_t rank = 0;
+            for (uint32_t other = 0; other < assoc; other++) {
+                rank += set->stamp[other] > set->stamp[way];
+            }
+            const uint8_t info =
+                (set->segment[way] == SLRUReplData::Protected ? 0x1 : 0) |
+                (set->flags[way] & Written ? 0x2 : 0) |
+                (set->flags[way] & Pinned ? 0x4 : 0);
+            lines.push_back({set->addr[way], set->index, way, rank, info});
+        }
+    }
+    std::sort(lines.begin(), lines.end(),
+        [](const Resident &a, const Resident &b) { return a.addr < b.addr; });
+
+    // Sorted addresses make the deltas small
+    std::string buf;
+    buf.reserve(16 + lines.size() * 8);
+    putVarint(buf, curTick());
+    putVarint(buf, lines.size());
+    Addr last = 0;
+    for (const auto &line : lines) {
+        putVarint(buf, line.addr - last);
+        putVarint(buf, line.set);
+        putVarint(buf, line.way);
+        putVarint(buf, line.rank);
+        buf.push_back(static_cast<char>(line.info));
+        last = line.addr;
+    }
+
+    // One buffer per snapshot, so that a dropped buffer never leaves a
+    // partial snapshot in the file
+    snapshotWriter->flush();
+    snapshotWriter->write(buf);
+    snapshotWriter->flush();
+    stats.snapshots++;
+
+    schedule(snapshotEvent, curTick() + snapshotInterval);
+}
+
+void
+SLRU::closeSnapshots()
+{
+    if (!snapshotWriter) {
+        return;
+    }
+
+    if (snapshotEvent.scheduled()) {
+        deschedule(snapshotEvent);
+    }
+    snapshotWriter->close();
+    warn_if(snapshotWriter->droppedBytes() > 0,
+            "%s: dropped %llu bytes of snapshots, the writer fell behind\n",
+            name(), snapshotWriter->droppedBytes());
+    snapshotWriter.reset();
+    simout.close(snapshotStream);
+    snapshotStream = nullptr;
+}
+
+SLRU::SampledSet *
+SLRU::getSampledSet(uint32_t set) const
+{
+    if (!datasetWriter || set % datasetSetSampling != 0) {
+        return nullptr;
+    }
+
+    const size_t idx = set / datasetSetSampling;
+    if (idx >= sampledSets.size()) {
+        sampledSets.resize(idx + 1);
+    }
+    if (!sampledSets[idx]) {
+        sampledSets[idx] = std::make_unique<SampledSet>();
+        sampledSets[idx]->lines.resize(assoc);
+    }
+    return sampledSets[idx].get();
+}
+
+uint8_t
+SLRU::requestType(const AccessHints &hints)
+{
+    return (hints.write ? WriteRequest : 0) |
+        (hints.pageTableWalk ? PageWalkRequest : 0) |
+        (hints.nonTemporal ? NonTemporalRequest : 0);
+}
+
+void
+SLRU::recordHit(const SetState &set, uint32_t way,
+                const AccessHints &hints) const
+{
+    SampledSet *sampled = getSampledSet(set.index);
+    if (sampled == nullptr) {
+        return;
+    }
+
+    sampled->clock++;
+    LineFeatures &line = sampled->lines[way];
+    writeRecord({hints.pc, set.addr[way], hints.requestor, line.hits,
+                 sampled->clock - line.fillTime, set.segment[way],
+                 requestType(hints), HitRecord, 1});
+    line.hits++;
+}
+
+void
+SLRU::recordEviction(const SetState &set, uint32_t way) const
+{
+    SampledSet *sampled = getSampledSet(set.index);
+    if (sampled == nullptr) {
+        return;
+    }
+
+    const LineFeatures &line = sampled->lines[way];
+    sampled->shadow.push_back({line.pc, set.addr[way], line.core, line.hits,
+                               sampled->clock - line.fillTime,
+                               set.segment[way], line.request,
+                               EvictionRecord, 0});
+    if (sampled->shadow.size() > assoc) {
+        writeRecord(sampled->shadow.front());
+        sampled->shadow.pop_front();
+    }
+}
+
+void
+SLRU::recordFill(const SetState &set, uint32_t way,
+                 const AccessHints &hints) const
+{
+    SampledSet *sampled = getSampledSet(set.index);
+    if (sampled == nullptr) {
+        return;
+    }
+
+    sampled->clock++;
+
+    // Refetching a shadowed line means it was evicted too early
+    if (hints.addr != MaxAddr) {
+        auto it = std::find_if(sampled->shadow.begin(), sampled->shadow.end(),
+            [&hints](const FeatureRecord &r) { return r.addr == hints.addr; });
+        if (it != sampled->shadow.end()) {
+            it->label = 1;
+            writeRecord(*it);
+            sampled->shadow.erase(it);
+            stats.shadowHits++;
+        }
+    }
+
+    sampled->lines[way] = {hints.pc, hints.requestor, sampled->clock, 0,
+                           requestType(hints)};
+}
+
+void
+SLRU::writeRecord(const FeatureRecord &record) const
+{
+    // Fixed-size records in host byte order, packed field by field so
+    // that the layout does not depend on struct padding
+    char buf[36];
+    size_t pos = 0;
+    auto put = [&buf, &pos](const auto &value)
+    {
+        std::memcpy(buf + pos, &value, sizeof(value));
+        pos += sizeof(value);
+    };
+    put(static_cast<uint64_t>(record.pc));
+    put(static_cast<uint64_t>(record.addr));
+    put(static_cast<int32_t>(record.core));
+    put(record.hits);
+    put(record.age);
+    put(record.segment);
+    put(record.request);
+    put(record.kind);
+    put(record.label);
+    assert(pos == sizeof(buf));
+    datasetWriter->write(buf, pos);
+    stats.datasetRecords++;
+}
+
+void
+SLRU::closeDataset()
+{
+    if (!datasetWriter) {
+        return;
+    }
+
+    // Evictions still in the shadow were not refetched in time
+    for (auto &sampled : sampledSets) {
+        if (!sampled) {
+            continue;
+        }
+        for (const auto &record : sampled->shadow) {
+            writeRecord(record);
+        }
+        sampled->shadow.clear();
+    }
+
+    datasetWriter->close();
+    warn_if(datasetWriter->droppedBytes() > 0,
+            "%s: dropped %llu bytes of dataset, the writer fell behind\n",
+            name(), datasetWriter->droppedBytes());
+    datasetWriter.reset();
+    simout.close(datasetStream);
+    datasetStream = nullptr;
+}
+
+void
+SLRU::loadPredictor(const std::string &path)
+{
+    std::ifstream is(path);
+    fatal_if(!is, "Could not open SLRU predictor file %s\n", path);
+
+    // Later rows override earlier ones, so wildcards give defaults that
+    // specific rows refine
+    std::string line;
+    unsigned lineno = 0;
+    while (std::getline(is, line)) {
+        lineno++;
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string kind;
+        if (!(fields >> kind)) {
+            continue;
+        }
+
+        if (kind == "pc_hash_bits") {
+            fatal_if(!insertTable.empty(),
+                     "%s:%u: pc_hash_bits given twice\n", path, lineno);
+            fatal_if(!(fields >> predictorPCBits) || predictorPCBits > 20,
+                     "%s:%u: pc_hash_bits must be between 0 and 20\n",
+                     path, lineno);
+            const size_t size = size_t(1) << (predictorPCBits + 3);
+            insertTable.assign(size, PredictDefault);
+            promoteTable.assign(size, PredictDefault);
+            continue;
+        }
+        fatal_if(insertTable.empty(),
+                 "%s:%u: pc_hash_bits must come first\n", path, lineno);
+
+        std::vector<uint8_t> *table;
+        std::vector<std::string> names;
+        if (kind == "insert") {
+            table = &insertTable;
+            names = {"default", "lru", "protected"};
+        } else if (kind == "promote") {
+            table = &promoteTable;
+            names = {"default", "never", "now"};
         } else {
-            // Find LRU in protected segment by comparing lastTouch ticks
-            auto lru_it = protectedList.begin();
-            Tick oldest = std::static_pointer_cast<SLRUReplData>(*lru_it)->lastTouch;
-            
-            for (auto it = protectedList.begin(); it != protectedList.end(); ++it) {
-                auto entry = std::static_pointer_cast<SLRUReplData>(*it);
-                if (entry->lastTouch < oldest) {
-                    oldest = entry->lastTouch;
-                    lru_it = it;
-                }
+            fatal("%s:%u: unknown row kind '%s'\n", path, lineno, kind);
+        }
+
+        std::string pc_str, request_str, decision_str;
+        fatal_if(!(fields >> pc_str >> request_str >> decision_str),
+                 "%s:%u: expected '%s <pc_hash|*> <request|*> <decision>'\n",
+                 path, lineno, kind);
+
+        const uint64_t pc_count = uint64_t(1) << predictorPCBits;
+        uint64_t pc_first = 0, pc_last = pc_count - 1;
+        if (pc_str != "*") {
+            fatal_if(!to_number(pc_str, pc_first) || pc_first >= pc_count,
+                     "%s:%u: bad PC hash '%s'\n", path, lineno, pc_str);
+            pc_last = pc_first;
+        }
+        unsigned request_first = 0, request_last = 7;
+        if (request_str != "*") {
+            fatal_if(!to_number(request_str, request_first) ||
+                     request_first > 7,
+                     "%s:%u: bad request type '%s'\n", path, lineno,
+                     request_str);
+            request_last = request_first;
+        }
+        const auto decision =
+            std::find(names.begin(), names.end(), decision_str);
+        fatal_if(decision == names.end(),
+                 "%s:%u: bad %s decision '%s'\n", path, lineno, kind,
+                 decision_str);
+
+        for (uint64_t pc = pc_first; pc <= pc_last; pc++) {
+            for (unsigned req = request_first; req <= request_last; req++) {
+                (*table)[pc << 3 | req] = decision - names.begin();
             }
+        }
+    }
+    fatal_if(insertTable.empty(), "%s: no pc_hash_bits row\n", path);
+}
+
+size_t
+SLRU::predictorIndex(const AccessHints &hints) const
+{
+    const Addr mask = (Addr(1) << predictorPCBits) - 1;
+    const Addr pc_hash =
+        ((hints.pc >> 2) ^ (hints.pc >> (2 + predictorPCBits))) & mask;
+    return pc_hash << 3 | requestType(hints);
+}
+
+uint8_t
+SLRU::predict(const std::vector<uint8_t> &table, const AccessHints &hints,
+              statistics::Vector &decisions) const
+{
+    if (table.empty()) {
+        return PredictDefault;
+    }
+
+    const uint8_t decision = hints.pc == MaxAddr ?
+        uint8_t(PredictDefault) : table[predictorIndex(hints)];
+    decisions[decision]++;
+    return decision;
+}
+
+SLRU::PCEntry *
+SLRU::lookupPC(Addr pc) const
+{
+    if (pcTable.empty() || pc == MaxAddr) {
+        return nullptr;
+    }
 
-            // Demote the LRU protected entry to probation
-            auto lru_data = std::static_pointer_cast<SLRUReplData>(*lru_it);
-            lru_data->segment = SLRUReplData::Probation;
-            protectedList.erase(lru_it);
-            
-            // Promote current entry to protected
-            data->segment = SLRUReplData::Protected;
-            protectedList.push_back(rd);
-            // protectedEntries remains the same (we replaced one)
+    // Open addressing with a bounded linear probe
+    const size_t mask = pcTable.size() - 1;
+    size_t idx = ((pc >> 2) ^ (pc >> 17)) & mask;
+    for (unsigned probe = 0; probe < maxPCProbes; probe++) {
+        PCEntry &entry = pcTable[idx];
+        if (entry.pc == pc) {
+            return &entry;
         }
-    } else {
-        // If already in protected, no need to do
+        if (entry.pc == MaxAddr) {
+            entry.pc = pc;
+            return &entry;
+        }
+        idx = (idx + 1) & mask;
+    }
+    stats.untrackedPCs++;
+    return nullptr;
+}
+
+void
+SLRU::resetStats()
+{
+    Base::resetStats();
+
+    std::fill(pcTable.begin(), pcTable.end(), PCEntry());
+    tracePhase("stats_reset");
+}
+
+void
+SLRU::preDumpStats()
+{
+    Base::preDumpStats();
+
+    tracePhase("stats_dump");
+    // Scores only change through recordLoadCommit(), which the CPU calls
+    warn_if_once(!criticality.empty() && !loadCommitsSeen,
+                 "%s: criticality_table_size is set but no load commits "
+                 "were reported; no line was filled as critical\n", name());
+    if (pcTable.empty()) {
+        return;
     }
-    data->lastTouch = now;
+
+    std::vector<const PCEntry*> used;
+    for (const auto &entry : pcTable) {
+        if (entry.pc != MaxAddr) {
+            used.push_back(&entry);
+        }
+    }
+    const size_t top = std::min<size_t>(pcReportTop, used.size());
+    std::partial_sort(used.begin(), used.begin() + top, used.end(),
+        [](const PCEntry *a, const PCEntry *b)
+        {
+            return a->misses != b->misses ? a->misses > b->misses :
+                a->pc < b->pc;
+        });
+
+    std::ostream &os = *pcReport->stream();
+    os << "---------- Begin SLRU per-PC report (tick " << curTick()
+       << ", " << used.size() << " PCs) ----------\n";
+    os << "pc misses hits promotions evictions_caused\n";
+    for (size_t i = 0; i < top; i++) {
+        const PCEntry &entry = *used[i];
+        os << "0x" << std::hex << entry.pc << std::dec << " "
+           << entry.misses << " " << entry.hits << " "
+           << entry.promotions << " " << entry.evictions << "\n";
+    }
+    os << "---------- End SLRU per-PC report ----------\n";
+    os.flush();
+}
+
+void
+SLRU::setRowBufferHint(const RowBufferHint *hint)
+{
+    rowHint = hint;
+}
+
+void
+SLRU::insertWindow(VictimCandidate *window, unsigned &size,
+                   const VictimCandidate &cand) const
+{
+    if (size == rowAwareWindow && cand.stamp >= window[size - 1].stamp) {
+        return;
+    }
+
+    // Keep the window sorted oldest first; a full window drops its newest
+    unsigned pos = std::min(size, rowAwareWindow - 1);
+    if (size < rowAwareWindow) {
+        size++;
+    }
+    while (pos > 0 && window[pos - 1].stamp > cand.stamp) {
+        window[pos] = window[pos - 1];
+        pos--;
+    }
+    window[pos] = cand;
+}
+
+unsigned
+SLRU::pickRowAware(const VictimCandidate *window, unsigned size) const
+{
+    if (rowHint == nullptr || size == 1) {
+        return 0;
+    }
+
+    // The window only holds valid lines: the victim scans return an empty
+    // way before building it, as no writeback can beat a free way. Lines
+    // filled without a packet have no address and are never matched.
+    for (unsigned i = 0; i < size; i++) {
+        if (window[i].addr != MaxAddr && rowHint->isRowOpen(window[i].addr)) {
+            stats.openRowVictims++;
+            if (i > 0) {
+                stats.rowAwareOverrides++;
+            }
+            return i;
+        }
+    }
+    return 0;
 }
 
 ReplaceableEntry*
@@ -95,30 +1355,178 @@ SLRU::getVictim(const ReplacementCandidates& candidates) const
 {
     assert(!candidates.empty());
 
-    ReplaceableEntry* oldestProb = nullptr;
-    Tick minProb = std::numeric_limits<Tick>::max();
+    // The candidates are the ways of one set, in way order. Plain cast:
+    // copying the shared_ptr would bump its refcount on every miss.
+    auto data = static_cast<const SLRUReplData*>(
+        candidates[0]->replacementData.get());
+    const uint32_t way = getVictimWay(data->set);
+    assert(way < candidates.size());
+    return candidates[way];
+}
 
-    for (auto *ent : candidates) {
-        auto data = std::static_pointer_cast<SLRUReplData>(
-            ent->replacementData);
+uint32_t
+SLRU::getVictimWay(uint32_t set) const
+{
+    const SetState *state = peekSet(set);
 
-        if (data->segment == SLRUReplData::Probation) {
-            if (data->lastTouch < minProb) {
-                minProb      = data->lastTouch;
-                oldestProb   = ent;
-            }
+    // A set that was never accessed holds no valid lines
+    if (state == nullptr) {
+        return 0;
+    }
+
+    VictimCandidate window[maxRowAwareWindow];
+    unsigned size = 0;
+    for (uint32_t way = 0; way < assoc; way++) {
+        // Empty ways are filled first, as in getVictim
+        if (!(state->flags[way] & Valid)) {
+            noteVictim(*setIndex[set], way);
+            return way;
+        }
+        if (state->segment[way] == SLRUReplData::Probation) {
+            insertWindow(window, size,
+                {state->stamp[way], state->addr[way], way});
         }
     }
     // We must have at least one probationary block to evict
-    assert(oldestProb && "No probationary entries available");
-    return oldestProb;
+    assert(size > 0 && "No probationary entries available");
+    const uint32_t victim = window[pickRowAware(window, size)].way;
+    noteVictim(*setIndex[set], victim);
+    return victim;
+}
 
+SLRU::SLRUStats::SLRUStats(statistics::Group *parent, unsigned num_cores)
+  : statistics::Group(parent),
+    ADD_STAT(promotions, statistics::units::Count::get(),
+             "Number of entries promoted to the protected segment"),
+    ADD_STAT(demotions, statistics::units::Count::get(),
+             "Number of protected entries demoted back to probation"),
+    ADD_STAT(filteredPromotions, statistics::units::Count::get(),
+             "Number of re-touches within the correlated-reference period "
+             "that were not promoted"),
+    ADD_STAT(nonTemporalFills, statistics::units::Count::get(),
+             "Number of fills with a non-temporal hint, inserted at the "
+             "probation LRU position"),
+    ADD_STAT(pinnedFills, statistics::units::Count::get(),
+             "Number of fills from a protected range that were pinned"),
+    ADD_STAT(pinnedHits, statistics::units::Count::get(),
+             "Number of hits on pinned entries"),
+    ADD_STAT(pinBudgetExhausted, statistics::units::Count::get(),
+             "Number of pin requests refused by the per-set pin budget"),
+    ADD_STAT(demotedFills, statistics::units::Count::get(),
+             "Number of fills from a demoted range"),
+    ADD_STAT(openRowVictims, statistics::units::Count::get(),
+             "Number of victims whose DRAM row was reported open"),
+    ADD_STAT(rowAwareOverrides, statistics::units::Count::get(),
+             "Number of victims chosen over an older probationary line "
+             "because their DRAM row was open"),
+    ADD_STAT(migrations, statistics::units::Count::get(),
+             "Number of promoted lines migrated toward the requestor's "
+             "nearest bank"),
+    ADD_STAT(replications, statistics::units::Count::get(),
+             "Number of promoted read-only lines replicated toward the "
+             "requestor's nearest bank"),
+    ADD_STAT(migrationsThrottled, statistics::units::Count::get(),
+             "Number of migrations skipped because the bank's budget for "
+             "the epoch was used up"),
+    ADD_STAT(savedHops, statistics::units::Count::get(),
+             "Network hops saved per access, summed over migrated and "
+             "replicated lines"),
+    ADD_STAT(sharedPromotions, statistics::units::Count::get(),
+             "Number of promotions of lines used by more than one "
+             "requestor, which bypass the correlation filter"),
+    ADD_STAT(victimRetries, statistics::units::Count::get(),
+             "Number of victim searches in a set whose previous victim was "
+             "never replaced"),
+    ADD_STAT(sharedEvictions, statistics::units::Count::get(),
+             "Number of victims that had been used by more than one "
+             "requestor"),
+    ADD_STAT(criticalFills, statistics::units::Count::get(),
+             "Number of fills by load PCs that often stall the ROB head"),
+    ADD_STAT(criticalPromotions, statistics::units::Count::get(),
+             "Number of lines filled by critical PCs that were inserted "
+             "protected or promoted past the correlation filter"),
+    ADD_STAT(pteFills, statistics::units::Count::get(),
+             "Number of fills by the page table walker"),
+    ADD_STAT(pteHits, statistics::units::Count::get(),
+             "Number of hits on lines filled by the page table walker"),
+    ADD_STAT(pteHitRate, statistics::units::Ratio::get(),
+             "Hit rate of lines filled by the page table walker"),
+    ADD_STAT(protectedHits, statistics::units::Count::get(),
+             "Number of hits on protected lines, which a two-speed array "
+             "would serve from its near ways"),
+    ADD_STAT(probationHits, statistics::units::Count::get(),
+             "Number of hits on probationary lines, mispredicted by a "
+             "protected-first way predictor"),
+    ADD_STAT(protectedHitRatio, statistics::units::Ratio::get(),
+             "Fraction of hits served by the protected segment"),
+    ADD_STAT(untrackedPCs, statistics::units::Count::get(),
+             "Number of accesses whose PC did not fit in the per-PC table"),
+    ADD_STAT(traceEvents, statistics::units::Count::get(),
+             "Number of events written to the trace file"),
+    ADD_STAT(snapshots, statistics::units::Count::get(),
+             "Number of resident-line snapshots taken"),
+    ADD_STAT(datasetRecords, statistics::units::Count::get(),
+             "Number of feature records written to the dataset"),
+    ADD_STAT(shadowHits, statistics::units::Count::get(),
+             "Number of sampled evictions whose line was refetched while "
+             "in the shadow, labelled as reused"),
+    ADD_STAT(insertDecisions, statistics::units::Count::get(),
+             "Insertion decisions of the predictor"),
+    ADD_STAT(promoteDecisions, statistics::units::Count::get(),
+             "Promotion decisions of the predictor on probationary "
+             "re-touches"),
+    ADD_STAT(crossEvictions, statistics::units::Count::get(),
+             "Evictions by evictor core (rows) and victim core and victim "
+             "history (columns)"),
+    ADD_STAT(ghostHits, statistics::units::Count::get(),
+             "Victims re-referenced while in the ghost buffer, by evictor "
+             "core (rows) and victim core (columns)")
+{
+    // A disabled matrix still needs a valid shape
+    const unsigned cores = std::max(num_cores, 1u);
+    crossEvictions
+        .init(cores, cores * 2)
+        .flags(statistics::nozero);
+    ghostHits
+        .init(cores, cores)
+        .flags(statistics::nozero);
+    for (unsigned core = 0; core < cores; core++) {
+        const std::string name = "core" + std::to_string(core);
+        crossEvictions.subname(core, name);
+        crossEvictions.ysubname(core * 2, name + "_probation");
+        crossEvictions.ysubname(core * 2 + 1, name + "_demoted");
+        ghostHits.subname(core, name);
+        ghostHits.ysubname(core, name);
+    }
+
+    insertDecisions
+        .init(NumPredictorDecisions)
+        .subname(PredictDefault, "default")
+        .subname(PredictLow, "lru")
+        .subname(PredictHigh, "protected");
+    promoteDecisions
+        .init(NumPredictorDecisions)
+        .subname(PredictDefault, "default")
+        .subname(PredictLow, "never")
+        .subname(PredictHigh, "now");
+
+    pteHitRate = pteHits / (pteHits + pteFills);
+    protectedHitRatio = protectedHits / (protectedHits + probationHits);
 }
 
 std::shared_ptr<ReplacementData>
 SLRU::instantiateEntry()
 {
-    return std::make_shared<SLRUReplData>();
+    // Caches instantiate their entries set by set, so consecutive groups of
+    // assoc entries share a set
+    const uint32_t set = numEntries / assoc;
+    const uint32_t way = numEntries % assoc;
+    numEntries++;
+
+    if (way == 0) {
+        setIndex.push_back(nullptr);
+    }
+    return std::make_shared<SLRUReplData>(set, way);
 }
 
 }
@@ -1,10 +1,19 @@
-
 #pragma once
 
 #include "params/SLRURP.hh"
+#include "base/addr_range.hh"
+#include "base/output.hh"
+#include "base/statistics.hh"
+#include "enums/SLRUPTEPolicy.hh"
 #include "mem/cache/replacement_policies/base.hh"
+#include "mem/cache/replacement_policies/slru_async_writer.hh"
+#include "mem/packet.hh"
 #include "sim/cur_tick.hh"
+#include "sim/eventq.hh"
+#include <cassert>
+#include <deque>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace gem5 {
@@ -15,41 +24,629 @@ class SLRUReplData : public ReplacementData
   public:
     enum Segment : uint8_t { Probation = 0, Protected = 1 };
 
-    Segment segment;
-    Tick lastTouch;
+    /**
+     * Position of the entry, fixed by instantiation order. Segment and
+     * recency live in the per-set state of the policy, indexed by these.
+     */
+    const uint32_t set;
+    const uint32_t way;
 
-    SLRUReplData()
-      : segment(Probation),
-        lastTouch(Tick(0))
+    SLRUReplData(uint32_t set, uint32_t way)
+      : set(set),
+        way(way)
     {}
 };
 
+/**
+ * Interface a memory controller implements to let SLRU prefer victims
+ * whose writeback, or clean drop, matches the currently open DRAM rows or
+ * the locality of its write queue.
+ */
+class RowBufferHint
+{
+  public:
+    virtual ~RowBufferHint() = default;
+
+    /** Whether an access to addr would currently be a row hit. */
+    virtual bool isRowOpen(Addr addr) const = 0;
+};
+
+/**
+ * Interface a NUCA-aware L2 controller implements to move hot lines
+ * toward the bank nearest to the core using them. SLRU calls it when a
+ * line is promoted to the protected segment.
+ */
+class MigrationHandler
+{
+  public:
+    virtual ~MigrationHandler() = default;
+
+    /**
+     * Migrate the line toward the requestor's nearest bank, or replicate
+     * it there if it is read-only.
+     *
+     * @return Hops saved per access, 0 if the line stays where it is.
+     */
+    virtual unsigned migrate(Addr addr, ContextID requestor,
+                             bool read_only) = 0;
+};
+
 class SLRU : public Base
 {
   public:
     using Params = SLRURPParams;
 
     /**
-     * @param p.protected_size 
+     * @param p.protected_size Protected entries per set
      * @param p.probation_size
+     * @param p.assoc Ways per set of the owning cache
+     * @param p.correlated_period Set accesses during which re-touches of a
+     *        probationary entry do not count toward promotion
+     * @param p.pin_budget Pinned entries per set
+     * @param p.pinned_ranges Ranges registered with RangeHint::Protect
+     * @param p.demoted_ranges Ranges registered with RangeHint::Demote
+     * @param p.row_aware_window Oldest probationary lines considered by
+     *        row-buffer-aware victim selection
+     * @param p.migration_budget Migrations per bank and epoch
+     * @param p.migration_epoch Length of a migration budget epoch
+     * @param p.sharing_aware Promote shared lines faster, demote them last
+     * @param p.criticality_table_size Entries of the per-PC criticality
+     *        table, 0 to disable it
+     * @param p.criticality_threshold Score from which a PC is critical
+     * @param p.pte_policy Treatment of lines filled by the page walker
+     * @param p.pc_table_size Entries of the per-PC attribution table
+     * @param p.pc_report_top PCs listed in the report at each stats dump
+     * @param p.trace_file Chrome trace of SLRU events, empty to disable
+     * @param p.trace_set_sampling Trace one set in every N
+     * @param p.snapshot_file Binary snapshots of resident lines, empty to
+     *        disable
+     * @param p.snapshot_interval Time between two snapshots
+     * @param p.dataset_file Feature records of sampled sets, empty to
+     *        disable
+     * @param p.dataset_set_sampling Record one set in every N
+     * @param p.writer_buffer_size Bytes of each output stream buffered
+     *        before a background write
+     * @param p.writer_max_pending Buffers queued per stream before data
+     *        is dropped
+     * @param p.predictor_file Decision table for insertion and promotion,
+     *        empty to disable it
+     * @param p.num_cores Cores of the interference matrix, 0 to disable it
+     * @param p.ghost_entries Entries of the ghost tag buffer
      */
     SLRU(const Params &p);
     ~SLRU() override = default;
 
     void invalidate(const std::shared_ptr<ReplacementData>& rd) override;
     void reset    (const std::shared_ptr<ReplacementData>& rd) const override;
+    void reset    (const std::shared_ptr<ReplacementData>& rd,
+                   const PacketPtr pkt) override;
     void touch    (const std::shared_ptr<ReplacementData>& rd) const override;
+    void touch    (const std::shared_ptr<ReplacementData>& rd,
+                   const PacketPtr pkt) override;
     ReplaceableEntry* getVictim(
         const ReplacementCandidates& candidates) const override;
 
+    /**
+     * Allocation-free victim selection. Scans the policy's own metadata of
+     * the set instead of a candidate list built by the cache, so callers
+     * such as CacheMemory::cacheProbe can index their set directly with
+     * the returned way. getVictim() maps its candidates onto it.
+     *
+     * @param set Set index, as derived from instantiation order.
+     * @return Way to evict.
+     */
+    uint32_t getVictimWay(uint32_t set) const;
+
     std::shared_ptr<ReplacementData> instantiateEntry() override;
 
+    /** Schedule the first snapshot. */
+    void startup() override;
+
+    void resetStats() override;
+
+    /** Write the top PCs of the attribution table to the report file. */
+    void preDumpStats() override;
+
+    /** Software guidance for the lines of an address range. */
+    enum class RangeHint : uint8_t
+    {
+        None,
+        /** Pin lines in the protected segment, within the pin budget. */
+        Protect,
+        /** Insert lines at probation LRU and never promote them. */
+        Demote,
+    };
+
+    /**
+     * Register a hint for an address range. This is the entry point for
+     * the pinned_ranges and demoted_ranges parameters, and for the Python
+     * bindings below. Hints only take effect for accesses that carry a
+     * packet.
+     */
+    void addRangeHint(const AddrRange &range, RangeHint hint);
+
+    /**
+     * Python entry points, so that a config script can change the hints
+     * while the simulation runs, e.g. on a work item or m5 exit event.
+     * The range is [start, end).
+     * @{
+     */
+    void pinRange(Addr start, Addr end);
+    void demoteRange(Addr start, Addr end);
+    /** @} */
+
+    /** Drop all range hints and unpin every resident line. */
+    void clearRangeHints();
+
+    /**
+     * Attach the memory controller hint used when row_aware_window > 1.
+     * Without one, the oldest probationary line is always the victim.
+     */
+    void setRowBufferHint(const RowBufferHint *hint);
+
+    /**
+     * Feed the per-PC criticality table. The O3 CPU reports each committed
+     * load that missed, and whether it blocked the ROB head; lines filled
+     * by PCs that often do are inserted protected.
+     */
+    void recordLoadCommit(Addr pc, bool stalled_head);
+
+    /** Attach the NUCA controller that handles promotion migrations. */
+    void setMigrationHandler(MigrationHandler *handler);
+
+    /**
+     * Add a global marker to the trace, e.g. around a region of interest.
+     * Stats resets and dumps are marked automatically, except for dumps
+     * taken in a forked child, whose trace writer has no thread; the
+     * parent marks those through the Python binding.
+     */
+    void tracePhase(const std::string &phase) const;
+
   private:
+    /** What the policy learns about an access from its packet. */
+    struct AccessHints
+    {
+        bool nonTemporal = false;
+        RangeHint range = RangeHint::None;
+        Addr addr = MaxAddr;
+        ContextID requestor = InvalidContextID;
+        Addr pc = MaxAddr;
+        bool pageTableWalk = false;
+        bool write = false;
+    };
+
+    AccessHints getHints(const PacketPtr pkt) const;
+
+    /**
+     * Warn once about enabled features that need the packet, for caches
+     * that only call the packet-less touch() and reset().
+     */
+    void warnPacketless() const;
+
+    void resetEntry(const SLRUReplData &data,
+                    const AccessHints &hints) const;
+    void touchEntry(const SLRUReplData &data,
+                    const AccessHints &hints) const;
+
+    /** Per-way flag bits kept next to the segment bytes. */
+    enum LineFlag : uint8_t
+    {
+        /** Filled by a non-temporal access and not re-touched since. */
+        NonTemporal = 0x1,
+        /** Protected on software request; never demoted. */
+        Pinned = 0x2,
+        /** Never promoted on software request. */
+        Demoted = 0x4,
+        /** Written since it was filled. */
+        Written = 0x8,
+        /** Filled by a PC whose loads often block commit. */
+        Critical = 0x10,
+        /** Filled by the page table walker. */
+        PageTable = 0x20,
+        /** Filled and not invalidated since. */
+        Valid = 0x40,
+        /** Protected at some point since the fill. */
+        Promoted = 0x80,
+    };
+
+    /**
+     * Per-set bookkeeping. It is only materialized the first time the set
+     * is filled or touched, so untouched sets of a large cache cost a
+     * single null pointer in setIndex.
+     *
+     * Recency is a per-set access stamp rather than a Tick. The stamps and
+     * segment bytes of a set are contiguous in cache-line aligned arrays,
+     * so the update on a hit and the scans on a miss touch the same host
+     * cache lines instead of chasing one heap object per way. A stamp of
+     * 0 marks the probation LRU position, which empty ways share with
+     * lines inserted there; only the Valid flag tells them apart.
+     */
+    struct SetState
+    {
+        /** Set index, as derived from instantiation order. */
+        uint32_t index;
+        uint32_t clock;
+        uint32_t protectedEntries;
+        uint32_t pinnedEntries;
+        /** Valid way picked by the last victim search, assoc if none. */
+        uint32_t victimWay;
+        /** Evicted line, kept until the refill names its evictor. */
+        Addr victimAddr;
+        uint8_t victimOwner;
+        bool victimPromoted;
+        uint32_t *stamp;
+        /** Stamp of the last uncorrelated reference, 0 if none. */
+        uint32_t *refStamp;
+        /** Address of the line, MaxAddr if unknown. */
+        Addr *addr;
+        /** One bit per requestor (context ID modulo 64) since the fill. */
+        uint64_t *sharers;
+        uint8_t *segment;
+        uint8_t *flags;
+        /** Core that filled the way, unknownOwner if not tracked. */
+        uint8_t *owner;
+    };
+
+    /** Host cache line, used to align the arena arrays. */
+    struct alignas(64) Line
+    {
+        uint8_t bytes[64];
+    };
+
+    /** Arena block backing setsPerChunk materialized sets. */
+    struct SetChunk
+    {
+        std::unique_ptr<SetState[]> sets;
+        std::unique_ptr<Line[]> stamps;
+        std::unique_ptr<Line[]> refStamps;
+        std::unique_ptr<Line[]> addrs;
+        std::unique_ptr<Line[]> sharers;
+        std::unique_ptr<Line[]> segments;
+        std::unique_ptr<Line[]> flags;
+        std::unique_ptr<Line[]> owners;
+    };
+
+    static constexpr unsigned setsPerChunk = 64;
+
+    SetState &getSet(uint32_t set) const;
+
+    /** Materialized state of a set, or nullptr if it was never accessed. */
+    const SetState *
+    peekSet(uint32_t set) const
+    {
+        assert(set < setIndex.size());
+        return setIndex[set];
+    }
+
+    /** Stamp the way as the most recently used of its set. */
+    void updateRecency(SetState &set, uint32_t way) const;
+
+    /**
+     * Move the least recently touched unpinned protected way back to
+     * probation.
+     *
+     * @return false if every protected way is pinned.
+     */
+    bool demoteLRU(SetState &set) const;
+
+    /** Move the way to the protected segment, demoting if it is full. */
+    bool protect(SetState &set, uint32_t way) const;
+
+    /** Protect and pin the way if the set's pin budget allows it. */
+    bool pin(SetState &set, uint32_t way) const;
+
+    /** Drop the way's segment, pin and flags before it is refilled. */
+    void releaseWay(SetState &set, uint32_t way) const;
+
+    /**
+     * Offer a freshly promoted line to the migration handler, within the
+     * bank's budget for the current epoch.
+     */
+    void requestMigration(const SetState &set, uint32_t way,
+                          const AccessHints &hints) const;
+
+    /** Remember the victim until it is invalidated or refilled. */
+    void noteVictim(SetState &set, uint32_t way) const;
+
+    /** Record the eviction of the line in the way, before it is lost. */
+    void evictWay(SetState &set, uint32_t way) const;
+
+    static constexpr uint8_t unknownOwner = 0xff;
+
+    /** Row or column of the requestor in the interference matrix. */
+    uint8_t coreIndex(ContextID requestor) const;
+
+    /** An evicted line, remembered to catch its quick re-reference. */
+    struct GhostEntry
+    {
+        Addr addr = MaxAddr;
+        uint8_t evictor = unknownOwner;
+        uint8_t victim = unknownOwner;
+    };
+
+    GhostEntry &ghostEntry(Addr addr) const;
+
+    /**
+     * Check the ghost buffer for the incoming line and, if the fill
+     * replaces the pending victim, charge its eviction to the filling core.
+     */
+    void noteInterference(SetState &set, bool evicted,
+                          const AccessHints &hints) const;
+
+    /** Append an event on the way to the trace if its set is sampled. */
+    void traceEvent(const SetState &set, uint32_t way,
+                    const char *event) const;
+
+    /** Terminate the trace and wait for the writer to drain it. */
+    void closeTrace();
+
+    /**
+     * Queue a snapshot of every resident line with a known address and
+     * schedule the next one.
+     */
+    void takeSnapshot();
+
+    void closeSnapshots();
+
+    /** Features of a resident line of a dataset-sampled set. */
+    struct LineFeatures
+    {
+        Addr pc = MaxAddr;
+        ContextID core = InvalidContextID;
+        /** Set access count at the fill. */
+        uint64_t fillTime = 0;
+        uint32_t hits = 0;
+        uint8_t request = 0;
+    };
+
+    /** Record kinds of the dataset. */
+    enum FeatureKind : uint8_t
+    {
+        HitRecord = 0,
+        EvictionRecord = 1,
+    };
+
+    /** Request type bits of the dataset. */
+    enum RequestBit : uint8_t
+    {
+        WriteRequest = 0x1,
+        PageWalkRequest = 0x2,
+        NonTemporalRequest = 0x4,
+    };
+
+    struct FeatureRecord
+    {
+        Addr pc;
+        Addr addr;
+        ContextID core;
+        uint32_t hits;
+        uint64_t age;
+        uint8_t segment;
+        uint8_t request;
+        uint8_t kind;
+        uint8_t label;
+    };
+
+    /**
+     * Dataset state of a sampled set. Evicted lines wait in a shadow FIFO
+     * of assoc entries; a refill of the same address while it is there
+     * labels the eviction as premature.
+     */
+    struct SampledSet
+    {
+        uint64_t clock = 0;
+        std::vector<LineFeatures> lines;
+        std::deque<FeatureRecord> shadow;
+    };
+
+    /** Dataset state of the set, nullptr if it is not sampled. */
+    SampledSet *getSampledSet(uint32_t set) const;
+
+    static uint8_t requestType(const AccessHints &hints);
+
+    /** Emit a hit record for the way, before it is updated. */
+    void recordHit(const SetState &set, uint32_t way,
+                   const AccessHints &hints) const;
+
+    /** Shadow the evicted line until it is refilled or ages out. */
+    void recordEviction(const SetState &set, uint32_t way) const;
+
+    /**
+     * Label the shadowed eviction of the incoming address, if any, and
+     * start tracking the new line.
+     */
+    void recordFill(const SetState &set, uint32_t way,
+                    const AccessHints &hints) const;
+
+    void writeRecord(const FeatureRecord &record) const;
+
+    /** Decisions stored in the predictor tables. */
+    enum PredictorDecision : uint8_t
+    {
+        /** Leave the decision to the policy. */
+        PredictDefault = 0,
+        /** Insert at probation LRU, or never promote on this re-touch. */
+        PredictLow = 1,
+        /** Insert protected, or promote on this re-touch. */
+        PredictHigh = 2,
+        NumPredictorDecisions
+    };
+
+    /**
+     * Parse a decision table file and compile it into the flat insertion
+     * and promotion tables, indexed by predictorIndex().
+     */
+    void loadPredictor(const std::string &path);
+
+    size_t predictorIndex(const AccessHints &hints) const;
+
+    /**
+     * Look the access up in one of the predictor tables.
+     *
+     * @param decisions Stat counting the decisions of the table.
+     * @return PredictDefault if no predictor is loaded or the PC is unknown.
+     */
+    uint8_t predict(const std::vector<uint8_t> &table,
+                    const AccessHints &hints,
+                    statistics::Vector &decisions) const;
+
+    /** Write out the shadowed evictions and wait for the writer. */
+    void closeDataset();
+
+    /** Per-PC counters; a pc of MaxAddr marks a free slot. */
+    struct PCEntry
+    {
+        Addr pc = MaxAddr;
+        uint64_t misses = 0;
+        uint64_t hits = 0;
+        uint64_t promotions = 0;
+        /** Valid lines evicted to make room for this PC's fills. */
+        uint64_t evictions = 0;
+    };
+
+    static constexpr unsigned maxPCProbes = 16;
+
+    /** Find or insert the PC's entry, nullptr if disabled or full. */
+    PCEntry *lookupPC(Addr pc) const;
+
+    /** A probationary line considered for eviction. */
+    struct VictimCandidate
+    {
+        uint32_t stamp;
+        Addr addr;
+        uint32_t way;
+    };
+
+    static constexpr unsigned maxRowAwareWindow = 16;
+
+    /** Add a candidate to the window of the oldest probationary lines. */
+    void insertWindow(VictimCandidate *window, unsigned &size,
+                      const VictimCandidate &cand) const;
+
+    /**
+     * Pick the oldest candidate of the window whose DRAM row is open, or
+     * the oldest one if there is none or no hint is attached.
+     *
+     * @return Position in the window.
+     */
+    unsigned pickRowAware(const VictimCandidate *window,
+                          unsigned size) const;
+
+    /** Whether more than one requestor used the way since its fill. */
+    bool isShared(const SetState &set, uint32_t way) const;
+
+    void addSharer(SetState &set, uint32_t way, ContextID requestor) const;
+
+    size_t criticalityIndex(Addr pc) const;
+
+    bool isCriticalPC(Addr pc) const;
+
+    /**
+     * Whether a re-touch of the way falls within the correlated-reference
+     * period of its last uncorrelated reference, in the spirit of 2Q's Kin
+     * queue and LRU-K's CRP.
+     */
+    bool isCorrelated(const SetState &set, uint32_t way) const;
+
+    const unsigned assoc;
     const unsigned protectedSize;
     const unsigned probationSize;
-    mutable unsigned protectedEntries;
+    const unsigned correlatedPeriod;
+    const unsigned pinBudget;
+    const unsigned rowAwareWindow;
+    const RowBufferHint *rowHint;
+    const bool sharingAware;
+    const enums::SLRUPTEPolicy ptePolicy;
+
+    /** Saturating per-PC scores, incremented on commit stalls. */
+    static constexpr unsigned maxCriticality = 7;
+    const unsigned criticalityThreshold;
+    std::vector<uint8_t> criticality;
+    /** Whether any load commit was ever reported. */
+    bool loadCommitsSeen;
+
+    mutable std::vector<PCEntry> pcTable;
+    const unsigned pcReportTop;
+    OutputStream *pcReport;
+    const unsigned traceSetSampling;
+    OutputStream *traceStream;
+    std::unique_ptr<SLRUAsyncWriter> traceWriter;
+    const Tick snapshotInterval;
+    OutputStream *snapshotStream;
+    std::unique_ptr<SLRUAsyncWriter> snapshotWriter;
+    EventFunctionWrapper snapshotEvent;
+    const unsigned datasetSetSampling;
+    OutputStream *datasetStream;
+    std::unique_ptr<SLRUAsyncWriter> datasetWriter;
+    mutable std::vector<std::unique_ptr<SampledSet>> sampledSets;
+
+    /** Bits of the hashed PC feature of the predictor. */
+    unsigned predictorPCBits;
+    std::vector<uint8_t> insertTable;
+    std::vector<uint8_t> promoteTable;
+
+    const unsigned numCores;
+    /** Direct-mapped, indexed by line address. */
+    mutable std::vector<GhostEntry> ghosts;
+    const unsigned migrationBudget;
+    const Tick migrationEpoch;
+    MigrationHandler *migrationHandler;
+    mutable Tick migrationEpochIndex;
+    mutable unsigned migrationsInEpoch;
+
+    std::vector<std::pair<AddrRange, RangeHint>> rangeHints;
+
+    /** Number of entries handed out by instantiateEntry(). */
+    uint64_t numEntries;
+
+    mutable std::vector<SetState*> setIndex;
+    mutable std::vector<SetChunk> setChunks;
+    mutable unsigned chunkUsed;
+
+    struct SLRUStats : public statistics::Group
+    {
+        SLRUStats(statistics::Group *parent, unsigned num_cores);
+
+        statistics::Scalar promotions;
+        statistics::Scalar demotions;
+        /** Re-touches that were not promoted for being correlated. */
+        statistics::Scalar filteredPromotions;
+        statistics::Scalar nonTemporalFills;
+        statistics::Scalar pinnedFills;
+        statistics::Scalar pinnedHits;
+        statistics::Scalar pinBudgetExhausted;
+        statistics::Scalar demotedFills;
+        statistics::Scalar openRowVictims;
+        statistics::Scalar rowAwareOverrides;
+        statistics::Scalar migrations;
+        statistics::Scalar replications;
+        statistics::Scalar migrationsThrottled;
+        statistics::Scalar savedHops;
+        statistics::Scalar sharedPromotions;
+        statistics::Scalar victimRetries;
+        statistics::Scalar sharedEvictions;
+        statistics::Scalar criticalFills;
+        statistics::Scalar criticalPromotions;
+        statistics::Scalar pteFills;
+        statistics::Scalar pteHits;
+        statistics::Formula pteHitRate;
+        statistics::Scalar protectedHits;
+        statistics::Scalar probationHits;
+        statistics::Formula protectedHitRatio;
+        statistics::Scalar untrackedPCs;
+        statistics::Scalar traceEvents;
+        statistics::Scalar snapshots;
+        statistics::Scalar datasetRecords;
+        statistics::Scalar shadowHits;
+        statistics::Vector insertDecisions;
+        statistics::Vector promoteDecisions;
+        /** Evictor core by victim core and victim history. */
+        statistics::Vector2d crossEvictions;
+        /** Evictor core by victim core, for re-referenced victims. */
+        statistics::Vector2d ghostHits;
+    };
 
-    mutable std::vector<std::shared_ptr<ReplacementData>> protectedList;
+    mutable SLRUStats stats;
 };
 
 }
@@ -27,7 +27,8 @@
 """
 Script to run SPEC CPU2017 benchmarks with gem5.
 The script expects a benchmark program name and the simulation
-size. The system is fixed with 2 CPU cores, MESI Two Level system
+size. The system has 2 CPU cores (see --num-cores), a MESI Two Level
+(or, with --cache-hierarchy, MESI Three Level, CHI or classic) system
 cache and 3 GB DDR4 memory. It uses the x86 board.
 
 This script will count the total number of instructions executed
@@ -50,9 +51,21 @@ import argparse
 import time
 import os
 import json
+import math
+import re
+import statistics
 
 import m5
-from m5.objects import Root
+from m5.objects import (
+    Root,
+    BaseCache,
+    RubyCache,
+    SLRURP,
+    LRURP,
+    TreePLRURP,
+    BRRIPRP,
+    RandomRP,
+)
 
 from gem5.utils.requires import requires
 from gem5.components.boards.x86_board import X86Board
@@ -62,6 +75,7 @@ from gem5.components.processors.simple_switchable_processor import (
     SwitchableProcessor,
 )
 from gem5.components.processors.cpu_types import CPUTypes
+from gem5.components.processors.simple_core import SimpleCore
 from gem5.isas import ISA
 from gem5.coherence_protocol import CoherenceProtocol
 from gem5.resources.resource import Resource, CustomDiskImageResource
@@ -72,14 +86,6 @@ from m5.stats.gem5stats import get_simstat
 from m5.util import warn
 from m5.util import fatal
 
-# We check for the required gem5 build.
-
-requires(
-    isa_required=ISA.X86,
-    coherence_protocol_required=CoherenceProtocol.MESI_TWO_LEVEL,
-    kvm_required=True,
-)
-
 # Following are the list of benchmark programs for SPEC CPU2017.
 # More information is available at:
 # https://www.gem5.org/documentation/benchmark_status/gem5-20
@@ -138,6 +144,18 @@ benchmark_choices = [
 
 size_choices = ["test", "train", "ref"]
 
+# Ruby cache hierarchies and the protocol each one needs in the gem5 build.
+
+hierarchy_protocols = {
+    "mesi-two-level": CoherenceProtocol.MESI_TWO_LEVEL,
+    "mesi-three-level": CoherenceProtocol.MESI_THREE_LEVEL,
+    "chi": CoherenceProtocol.CHI,
+    # The classic memory system works with any Ruby protocol in the build
+    "classic": None,
+}
+
+replacement_policy_choices = ["slru", "lru", "tree-plru", "brrip", "random"]
+
 parser = argparse.ArgumentParser(
     description="An example configuration script to run the \
         SPEC CPU2017 benchmarks."
@@ -180,8 +198,120 @@ parser.add_argument(
     choices=size_choices,
 )
 
+parser.add_argument(
+    "--cache-hierarchy",
+    type=str,
+    default="mesi-two-level",
+    help="Ruby cache hierarchy to simulate.",
+    choices=list(hierarchy_protocols),
+)
+
+parser.add_argument(
+    "--num-cores",
+    type=int,
+    default=2,
+    help="Number of cores. The ROI is measured on the second core, so at \
+    least 2 are needed.",
+)
+
+for level in ["l1", "l2", "l3"]:
+    parser.add_argument(
+        "--{}-rp".format(level),
+        type=str,
+        default=None,
+        help="Replacement policy of the {} caches. By default Ruby caches \
+        use SLRU and classic caches LRU.".format(level.upper()),
+        choices=replacement_policy_choices,
+    )
+
+parser.add_argument(
+    "--cross-check-stats",
+    type=str,
+    default=None,
+    help="stats.txt of another run of the same benchmark, e.g. a Ruby run \
+    to cross-check a classic one. Its per-level miss rates are printed \
+    next to this run's. Needs explicit --l1-rp and --l2-rp, since Ruby \
+    and classic caches default to different policies.",
+)
+
+parser.add_argument(
+    "--smarts",
+    action="store_true",
+    help="Sample the ROI SMARTS-style instead of measuring one contiguous \
+    window: functional warming on atomic cores alternates with detailed \
+    warming and measurement on timing cores. Needs --cache-hierarchy \
+    classic, as Ruby does not support atomic accesses.",
+)
+
+parser.add_argument(
+    "--smarts-samples",
+    type=int,
+    default=0,
+    help="Maximum number of SMARTS measurement windows. Sampling otherwise \
+    goes on until the benchmark exits; 0 means no cap.",
+)
+
+parser.add_argument(
+    "--smarts-warming-insts",
+    type=int,
+    default=10000000,
+    help="Instructions of functional warming before each window.",
+)
+
+parser.add_argument(
+    "--smarts-detailed-warmup",
+    type=int,
+    default=20000,
+    help="Instructions of detailed warming before each window.",
+)
+
+parser.add_argument(
+    "--smarts-measure-insts",
+    type=int,
+    default=10000,
+    help="Instructions of each SMARTS measurement window.",
+)
+
+parser.add_argument(
+    "--async-stats",
+    action="store_true",
+    help="Dump stats from a forked snapshot of the simulator, so that \
+    formatting and writing them does not stall the simulation.",
+)
+
 args = parser.parse_args()
 
+# We check for the required gem5 build.
+
+requires(
+    isa_required=ISA.X86,
+    coherence_protocol_required=hierarchy_protocols[args.cache_hierarchy],
+    kvm_required=True,
+)
+
+if args.cache_hierarchy in ["mesi-two-level", "classic"] and args.l3_rp:
+    fatal("--l3-rp needs a hierarchy with an L3.")
+
+if args.cache_hierarchy == "chi" and (args.l2_rp or args.l3_rp):
+    fatal("The CHI hierarchy only has private L1 caches, use --l1-rp.")
+
+# Ruby caches default to SLRU and classic ones to LRU, so relying on the
+# defaults would compare two different policies
+if args.cross_check_stats and (
+    args.l1_rp is None
+    or (args.l2_rp is None and args.cache_hierarchy != "chi")
+):
+    fatal("--cross-check-stats needs --l1-rp and --l2-rp.")
+
+if args.num_cores < 2:
+    fatal("--num-cores must be at least 2.")
+
+if args.smarts and args.cache_hierarchy != "classic":
+    fatal("--smarts needs --cache-hierarchy classic for functional warming.")
+
+if args.smarts and (args.smarts_samples < 0 or args.smarts_samples == 1):
+    fatal("--smarts-samples must be 0 (no cap) or at least 2.")
+
 # We expect the user to input the full path of the disk-image.
 if args.image[0] != "/":
     # We need to get the absolute path to this file. We assume that the file is
@@ -197,21 +327,214 @@ if not os.path.exists(args.image):
     fatal("The disk-image is not found at {}".format(args.image))
 
 # Setting up all the fixed system parameters here
-# Caches: MESI Two Level Cache Hierarchy
 
-from gem5.components.cachehierarchies.ruby.mesi_two_level_cache_hierarchy import (
-    MESITwoLevelCacheHierarchy,
-)
 
-cache_hierarchy = MESITwoLevelCacheHierarchy(
-    l1d_size="16kB",
-    l1d_assoc=8,
-    l1i_size="16kB",
-    l1i_assoc=8,
-    l2_size="1MB",
-    l2_assoc=16,
-    num_l2_banks=2,
-)
+def make_replacement_policy(name, assoc, shared, classic):
+    """
+    Build one replacement policy instance. SLRU keeps a larger protected
+    segment in caches shared by all the cores. Only classic caches pass
+    packets to the policy, so only there can SLRU tell the requestors
+    apart, be sharing-aware and record cross-core interference. Shared
+    lines skip the correlated-reference filter, which then has to be on
+    for sharing awareness to matter.
+    """
+    if name == "slru":
+        protected = assoc * 3 // 4 if shared else assoc // 2
+        sharing_aware = shared and classic
+        return SLRURP(
+            protected_size=protected,
+            probation_size=assoc - protected,
+            correlated_period=assoc if sharing_aware else 0,
+            sharing_aware=sharing_aware,
+            num_cores=args.num_cores if shared and classic else 0,
+        )
+    return {
+        "lru": LRURP,
+        "tree-plru": TreePLRURP,
+        "brrip": BRRIPRP,
+        "random": RandomRP,
+    }[name]()
+
+
+def set_replacement_policy(controllers, name, assoc, shared=False):
+    """
+    Give every Ruby or classic cache of the controllers its own policy.
+    Classic caches can be passed directly.
+    """
+    if name is None:
+        return
+    for controller in controllers:
+        caches = [
+            obj
+            for obj in controller.descendants()
+            if isinstance(obj, (RubyCache, BaseCache))
+        ]
+        for cache in caches:
+            cache.replacement_policy = make_replacement_policy(
+                name, assoc, shared, isinstance(cache, BaseCache)
+            )
+
+
+if args.cache_hierarchy == "classic":
+    # Caches: classic memory system with private L1 caches and a shared L2
+    # behind a snooping crossbar. Much faster than Ruby for single-thread
+    # policy studies.
+
+    from gem5.components.cachehierarchies.classic.private_l1_shared_l2_cache_hierarchy import (
+        PrivateL1SharedL2CacheHierarchy,
+    )
+
+    class SLRUClassicCacheHierarchy(PrivateL1SharedL2CacheHierarchy):
+        """
+        Classic private L1, shared L2 hierarchy with a replacement policy
+        per level. SLRU works on the BaseSetAssoc tags of the caches.
+        """
+
+        def __init__(self, l1_rp=None, l2_rp=None, **kwargs):
+            super().__init__(**kwargs)
+            self._l1_rp = l1_rp
+            self._l2_rp = l2_rp
+
+        def incorporate_cache(self, board):
+            super().incorporate_cache(board)
+            set_replacement_policy(
+                list(self.l1icaches) + list(self.l1dcaches),
+                self._l1_rp,
+                self._l1d_assoc,
+            )
+            set_replacement_policy(
+                [self.l2cache], self._l2_rp, self._l2_assoc, shared=True
+            )
+
+    cache_hierarchy = SLRUClassicCacheHierarchy(
+        l1_rp=args.l1_rp,
+        l2_rp=args.l2_rp,
+        l1d_size="16kB",
+        l1d_assoc=8,
+        l1i_size="16kB",
+        l1i_assoc=8,
+        l2_size="1MB",
+        l2_assoc=16,
+    )
+elif args.cache_hierarchy == "chi":
+    # Caches: CHI with private L1 caches per core and a home node in front
+    # of memory
+
+    from gem5.components.cachehierarchies.chi.private_l1_cache_hierarchy import (
+        PrivateL1CacheHierarchy,
+    )
+
+    class SLRUCHICacheHierarchy(PrivateL1CacheHierarchy):
+        """
+        CHI hierarchy with a selectable L1 replacement policy. CHI caches
+        may search for a victim again when the first one is busy, which
+        SLRU handles by only recording the eviction that happens.
+        """
+
+        def __init__(self, l1_rp=None, **kwargs):
+            super().__init__(**kwargs)
+            self._l1_rp = l1_rp
+
+        def incorporate_cache(self, board):
+            super().incorporate_cache(board)
+            set_replacement_policy(
+                self.core_clusters, self._l1_rp, self._assoc
+            )
+
+    cache_hierarchy = SLRUCHICacheHierarchy(
+        l1_rp=args.l1_rp,
+        size="16kB",
+        assoc=8,
+    )
+elif args.cache_hierarchy == "mesi-three-level":
+    # Caches: MESI Three Level Cache Hierarchy, with private L1 and L2
+    # caches and a banked L3 shared by all the cores
+
+    from gem5.components.cachehierarchies.ruby.mesi_three_level_cache_hierarchy import (
+        MESIThreeLevelCacheHierarchy,
+    )
+
+    class SLRUThreeLevelCacheHierarchy(MESIThreeLevelCacheHierarchy):
+        """
+        MESI Three Level hierarchy with a replacement policy per level.
+        """
+
+        def __init__(self, l1_rp=None, l2_rp=None, l3_rp=None, **kwargs):
+            super().__init__(**kwargs)
+            self._l1_rp = l1_rp
+            self._l2_rp = l2_rp
+            self._l3_rp = l3_rp
+
+        def incorporate_cache(self, board):
+            super().incorporate_cache(board)
+            set_replacement_policy(
+                self._l1_controllers, self._l1_rp, self._l1d_assoc
+            )
+            set_replacement_policy(
+                self._l2_controllers, self._l2_rp, self._l2_assoc
+            )
+            set_replacement_policy(
+                self._l3_controllers,
+                self._l3_rp,
+                self._l3_assoc,
+                shared=True,
+            )
+
+    cache_hierarchy = SLRUThreeLevelCacheHierarchy(
+        l1_rp=args.l1_rp,
+        l2_rp=args.l2_rp,
+        l3_rp=args.l3_rp,
+        l1d_size="16kB",
+        l1d_assoc=8,
+        l1i_size="16kB",
+        l1i_assoc=8,
+        l2_size="256kB",
+        l2_assoc=8,
+        l3_size="4MB",
+        l3_assoc=16,
+        num_l3_banks=2,
+    )
+else:
+    # Caches: MESI Two Level Cache Hierarchy
+
+    from gem5.components.cachehierarchies.ruby.mesi_two_level_cache_hierarchy import (
+        MESITwoLevelCacheHierarchy,
+    )
+
+    class SLRUTwoLevelCacheHierarchy(MESITwoLevelCacheHierarchy):
+        """
+        MESI Two Level hierarchy with per-level replacement policies for
+        the SLRU experiments. The RubyCache objects only exist once the
+        hierarchy is incorporated into the board, so the policies are set
+        there.
+        """
+
+        def __init__(self, l1_rp=None, l2_rp=None, **kwargs):
+            super().__init__(**kwargs)
+            self._l1_rp = l1_rp
+            self._l2_rp = l2_rp
+
+        def incorporate_cache(self, board):
+            super().incorporate_cache(board)
+            set_replacement_policy(
+                self._l1_controllers, self._l1_rp, self._l1d_assoc
+            )
+            set_replacement_policy(
+                self._l2_controllers, self._l2_rp, self._l2_assoc, shared=True
+            )
+
+    cache_hierarchy = SLRUTwoLevelCacheHierarchy(
+        l1_rp=args.l1_rp,
+        l2_rp=args.l2_rp,
+        l1d_size="16kB",
+        l1d_assoc=8,
+        l1i_size="16kB",
+        l1i_assoc=8,
+        l2_size="1MB",
+        l2_assoc=16,
+        num_l2_banks=2,
+    )
+
 # Memory: Dual Channel DDR4 2400 DRAM device.
 # The X86 board only supports 3 GB of main memory.
 
@@ -224,14 +547,36 @@ memory = DualChannelDDR4_2400(size="3GB")
 # we start with KVM cores to simulate the OS boot, then switch to the Timing
 # cores for the command we wish to run after boot.
 
-processor = SimpleSwitchableProcessor(
-    starting_core_type=CPUTypes.KVM,
-    switch_core_type=CPUTypes.TIMING,
-    isa=ISA.X86,
-    num_cores=2,
-)
+#
+# SMARTS sampling needs a third core type: atomic cores warm the caches and
+# SLRU state functionally between the detailed windows of the timing cores.
+
+if args.smarts:
+    smarts_cores = {
+        cpu_type: [
+            SimpleCore(cpu_type=core_type, core_id=i, isa=ISA.X86)
+            for i in range(args.num_cores)
+        ]
+        for cpu_type, core_type in [
+            ("kvm", CPUTypes.KVM),
+            ("atomic", CPUTypes.ATOMIC),
+            ("detailed", CPUTypes.TIMING),
+        ]
+    }
+    processor = SwitchableProcessor(
+        switchable_cores=smarts_cores, starting_cores="kvm"
+    )
+    kvm_cores = smarts_cores["kvm"]
+else:
+    processor = SimpleSwitchableProcessor(
+        starting_core_type=CPUTypes.KVM,
+        switch_core_type=CPUTypes.TIMING,
+        isa=ISA.X86,
+        num_cores=args.num_cores,
+    )
+    kvm_cores = processor.start
 
-for proc in processor.start:
+for proc in kvm_cores:
     proc.core.usePerf = False
 
 # Trying to make 3 processors with different max_insts_all_threads so that we can 
@@ -297,6 +642,131 @@ board.set_kernel_disk_workload(
     ),
     readfile_contents=command,
 )
+# Demand hit and miss counters per cache level: Ruby MESI controllers are
+# grouped per level, Ruby CHI L1 controllers per core, and classic caches
+# report their own totals. Patterns without a level group give it below.
+
+level_stat_patterns = [
+    (
+        re.compile(r"\.(l\d)_controllers\d*\.\w+\.m_demand_(hits|misses)"
+                   r"\s+(\d+)"),
+        None,
+    ),
+    (
+        re.compile(r"\.core_clusters\d*\.\w+\.cache\.m_demand_(hits|misses)"
+                   r"\s+(\d+)"),
+        "l1",
+    ),
+    (
+        re.compile(r"\.l1[di]caches\d*\.demand(Hits|Misses)::total\s+(\d+)"),
+        "l1",
+    ),
+    (
+        re.compile(r"\.l2cache\.demand(Hits|Misses)::total\s+(\d+)"),
+        "l2",
+    ),
+]
+
+
+final_tick_pattern = re.compile(r"finalTick\s+(\d+)")
+
+
+def read_level_stats_dumps(stats_file):
+    """
+    Sum the demand hits and misses over the caches of each level, for every
+    stats dump. Returns (final tick, levels) pairs in dump order.
+    """
+    dumps = [(None, {})]
+    with open(stats_file) as f:
+        for line in f:
+            if line.startswith("---------- Begin Simulation Statistics"):
+                dumps.append((None, {}))
+            final_tick = final_tick_pattern.match(line)
+            if final_tick is not None:
+                dumps[-1] = (int(final_tick.group(1)), dumps[-1][1])
+                continue
+            levels = dumps[-1][1]
+            for pattern, fixed_level in level_stat_patterns:
+                match = pattern.search(line)
+                if match is None:
+                    continue
+                if fixed_level is None:
+                    level, kind, count = match.groups()
+                else:
+                    level = fixed_level
+                    kind, count = match.groups()
+                counts = levels.setdefault(level, [0, 0])
+                counts[kind.lower() == "misses"] += int(count)
+                break
+    return dumps[1:] if len(dumps) > 1 else dumps
+
+
+def read_level_stats(stats_file):
+    """Per-level demand hits and misses of the last stats dump (the ROI)."""
+    return read_level_stats_dumps(stats_file)[-1][1]
+
+
+def miss_rate(hits, misses):
+    accesses = hits + misses
+    return misses / accesses if accesses else 0.0
+
+
+def print_level_stats(levels, reference=None):
+    """Print each level's miss rate, and the reference run's if given."""
+    for level, (hits, misses) in sorted(levels.items()):
+        line = "%s: %d accesses, %d misses, miss rate %.4f" % (
+            level.upper(),
+            hits + misses,
+            misses,
+            miss_rate(hits, misses),
+        )
+        if reference is not None and level in reference:
+            ref_rate = miss_rate(*reference[level])
+            line += ", reference miss rate %.4f (%+.4f)" % (
+                ref_rate,
+                miss_rate(hits, misses) - ref_rate,
+            )
+        print(line)
+
+
+# Stats dumps still being written by a forked snapshot, oldest first.
+
+pending_dumps = []
+
+
+def wait_for_dumps():
+    """Wait until every asynchronous stats dump is in the stats file."""
+    while pending_dumps:
+        os.waitpid(pending_dumps.pop(0), 0)
+
+
+def dump_stats():
+    """
+    Dump the stats. With --async-stats the dump runs in a forked child,
+    which holds a copy-on-write snapshot of the stat values, while the
+    simulation goes on in the parent; the stats can be reset right away.
+    """
+    if not args.async_stats:
+        m5.stats.dump()
+        return
+
+    # The child's trace writers have no thread, so the parent marks the dump
+    for obj in board.descendants():
+        if isinstance(obj, SLRURP) and obj.trace_file:
+            obj.tracePhase("stats_dump")
+
+    # Children append to the same stats file, so dumps must not overlap
+    wait_for_dumps()
+    pid = os.fork()
+    if pid == 0:
+        try:
+            m5.stats.dump()
+        finally:
+            # Skip the exit callbacks and destructors of the simulator
+            os._exit(0)
+    pending_dumps.append(pid)
+
+
 warmup_insts = 5000000000 
 measure_insts = 1000000000
 
@@ -316,7 +786,7 @@ def handle_exit():
     
     print("Dump stats at the end of the ROI!")
 
-    m5.stats.dump()
+    dump_stats()
     yield True
 
 
@@ -325,17 +795,129 @@ def handle_schedule():
     processor.get_cores()[1].core.scheduleInstStop(0, measure_insts, "Tick exit reached")
     m5.stats.reset()
     yield False
-    m5.stats.dump()
+    dump_stats()
+    yield True
+
+
+# SMARTS samples: ticks per instruction and the tick of the stats dump of
+# each measurement window.
+
+smarts_samples = []
+
+
+def smarts_sampling():
+    """
+    Run the SMARTS windows one after the other until the benchmark exits,
+    or until --smarts-samples windows if it is set. Each period is
+    functional warming on the atomic cores, detailed warming and then
+    measurement on the timing cores, each phase ending on an instruction
+    count of the second core, so windows are evenly spaced over the whole
+    benchmark.
+    """
+    sample = 0
+    while args.smarts_samples == 0 or sample < args.smarts_samples:
+        processor.switch_to_processor("atomic")
+        smarts_cores["atomic"][1].core.scheduleInstStop(
+            0, args.smarts_warming_insts, "Tick exit reached"
+        )
+        yield False
+
+        processor.switch_to_processor("detailed")
+        if args.smarts_detailed_warmup > 0:
+            smarts_cores["detailed"][1].core.scheduleInstStop(
+                0, args.smarts_detailed_warmup, "Tick exit reached"
+            )
+            yield False
+
+        m5.stats.reset()
+        window_start = m5.curTick()
+        smarts_cores["detailed"][1].core.scheduleInstStop(
+            0, args.smarts_measure_insts, "Tick exit reached"
+        )
+        yield False
+
+        # The window's stats are read back from the stats file after the
+        # run, so asynchronous dumps are not waited for here
+        dump_stats()
+        smarts_samples.append(
+            (
+                (m5.curTick() - window_start) / args.smarts_measure_insts,
+                m5.curTick(),
+            )
+        )
+        sample += 1
+        print("SMARTS sample %d done" % sample)
+    print("Reached --smarts-samples, ending before the benchmark exits")
+    yield True
+
+
+def handle_smarts_exit():
+    print("Done booting Linux")
+    print("Starting SMARTS sampling of the ROI")
+    # Starts the first functional warming interval; the scheduled
+    # instruction stops drive the rest
+    next(smarts)
+    yield False
+    print("The benchmark exited after %d SMARTS samples" % len(smarts_samples))
     yield True
 
 
-simulator = Simulator(
-    board=board,
-    on_exit_event={
+def confidence_interval(values):
+    """Mean and 95% confidence half-width, with the normal approximation."""
+    mean = statistics.mean(values)
+    half_width = 1.96 * statistics.stdev(values) / math.sqrt(len(values))
+    return mean, half_width
+
+
+def read_smarts_samples(stats_file):
+    """Match each SMARTS window with its dump in the stats file by tick."""
+    dumps = {}
+    for tick, levels in read_level_stats_dumps(stats_file):
+        dumps.setdefault(tick, levels)
+    return [(tpi, dumps.get(tick, {})) for tpi, tick in smarts_samples]
+
+
+def print_smarts_report(samples):
+    print(
+        "SMARTS: %d samples of %d instructions"
+        % (len(samples), args.smarts_measure_insts)
+    )
+    if len(samples) < 2:
+        print("Not enough samples for a confidence interval")
+        return
+    mean, half_width = confidence_interval([tpi for tpi, _ in samples])
+    print(
+        "Ticks per instruction: %.2f +/- %.2f (95%% CI, %.2f%%)"
+        % (mean, half_width, 100 * half_width / mean if mean else 0.0)
+    )
+    for level in sorted(samples[-1][1]):
+        rates = [
+            miss_rate(*levels[level])
+            for _, levels in samples
+            if level in levels
+        ]
+        if len(rates) < 2:
+            continue
+        mean, half_width = confidence_interval(rates)
+        print(
+            "%s miss rate: %.4f +/- %.4f (95%% CI)"
+            % (level.upper(), mean, half_width)
+        )
+
+
+if args.smarts:
+    smarts = smarts_sampling()
+    on_exit_event = {
+        ExitEvent.EXIT: handle_smarts_exit(),
+        ExitEvent.SCHEDULED_TICK: smarts,
+    }
+else:
+    on_exit_event = {
         ExitEvent.EXIT: handle_exit(),
         ExitEvent.SCHEDULED_TICK: handle_schedule(),
-    },
-)
+    }
+
+simulator = Simulator(board=board, on_exit_event=on_exit_event)
 
 # We maintain the wall clock time.
 
@@ -367,3 +949,21 @@ print(
     "Total wallclock time: %.2fs, %.2f min"
     % (time.time() - globalStart, (time.time() - globalStart) / 60)
 )
+
+
+wait_for_dumps()
+
+if args.smarts:
+    print()
+    print_smarts_report(
+        read_smarts_samples(os.path.join(m5.options.outdir, "stats.txt"))
+    )
+
+print()
+print("Per-level cache statistics (last stats dump):")
+print_level_stats(
+    read_level_stats(os.path.join(m5.options.outdir, "stats.txt")),
+    reference=read_level_stats(args.cross_check_stats)
+    if args.cross_check_stats
+    else None,
+)